@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "types.hpp"
+#include "common.hpp"
+#include "hash-batch.hpp"
+
+/// Parallel group-by without shared atomics. Every worker pre-aggregates
+/// into its own hash table, split into PARTITIONS partitions by the top bits
+/// of the group hash. The merge combines partition p of all workers on a
+/// single worker, so no two workers ever update the same group. This replaces
+/// atomicAdd/atomicMin/atomicMax on shared groups, which serialize on the
+/// group's cache line when a query has few groups (Q1 has 4):
+///
+///   aggregate::Aggregation<std::tuple<Char<1>, Char<1>>, State> groups(threads);
+///   // on worker w
+///   groups.local(w)[{returnflag[i], linestatus[i]}].add(...);
+///   // after all workers finished
+///   for (auto& [key, state] : groups.merge()) ...
+///
+/// Keys are types.hpp values, integers or tuples of them, hashed like
+/// hashing::hash_columns so callers may pass batch-computed hashes to insert().
+/// States are default-constructible and merge with merge(const State&) or +=.
+namespace aggregate {
+
+    static constexpr unsigned PARTITION_BITS = 6;
+    static constexpr size_t PARTITIONS = size_t(1) << PARTITION_BITS;
+    static constexpr size_t INITIAL_SLOTS = 16;
+
+    template <typename Key>
+    inline uint64_t hash_key(const Key& key) {
+        if constexpr (std::is_integral_v<Key>) {
+            return hashing::hash_int(static_cast<int64_t>(key));
+        } else if constexpr (requires { std::tuple_size<Key>::value; }) {
+            return std::apply([](const auto& first, const auto&... rest) {
+                auto hash = hash_key(first);
+                ((hash = hashing::combine(hash, hash_key(rest))), ...);
+                return hash;
+            }, key);
+        } else {
+            return hashing::hash(key);
+        }
+    }
+
+    template <typename State>
+    inline void merge_state(State& into, const State& from) {
+        if constexpr (requires { into.merge(from); }) {
+            into.merge(from);
+        } else {
+            into += from;
+        }
+    }
+
+    /// Open addressing with linear probing. Groups are kept densely in
+    /// insertion order, the slots hold their index + 1.
+    template <typename Key, typename State>
+    struct Table {
+        struct Group {
+            uint64_t hash;
+            Key key;
+            State state;
+        };
+
+        std::vector<Group> groups;
+        std::vector<uint32_t> slots;
+
+        inline size_t size() const { return groups.size(); }
+
+        State& find_or_insert(const Key& key, uint64_t hash) {
+            if (groups.size() * 2 >= slots.size()) {
+                grow();
+            }
+            auto mask = slots.size() - 1;
+            for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+                auto index = slots[slot];
+                if (!index) {
+                    groups.push_back(Group{hash, key, State()});
+                    slots[slot] = groups.size();
+                    return groups.back().state;
+                }
+                auto& group = groups[index - 1];
+                if (group.hash == hash && group.key == key) {
+                    return group.state;
+                }
+            }
+        }
+
+    private:
+        void grow() {
+            slots.assign(std::max(INITIAL_SLOTS, slots.size() * 2), 0);
+            auto mask = slots.size() - 1;
+            for (auto index = 0u; index != groups.size(); ++index) {
+                auto slot = groups[index].hash & mask;
+                while (slots[slot]) {
+                    slot = (slot + 1) & mask;
+                }
+                slots[slot] = index + 1;
+            }
+        }
+    };
+
+    /// The pre-aggregation table of one worker.
+    template <typename Key, typename State>
+    struct LocalTable {
+        std::array<Table<Key, State>, PARTITIONS> partitions;
+
+        inline State& operator[](const Key& key) {
+            return insert(key, hash_key(key));
+        }
+
+        /// `hash` must be hash_key(key).
+        inline State& insert(const Key& key, uint64_t hash) {
+            return partitions[hash >> (64 - PARTITION_BITS)].find_or_insert(key, hash);
+        }
+    };
+
+    template <typename Key, typename State>
+    class Aggregation {
+    public:
+        using group_t = std::pair<Key, State>;
+
+        explicit Aggregation(unsigned threads) : threads(threads), locals(threads) {}
+
+        inline LocalTable<Key, State>& local(unsigned worker) { return locals[worker]; }
+
+        /// Merges the worker tables one partition per worker at a time and
+        /// returns the groups in no particular order. The worker tables are
+        /// consumed.
+        std::vector<group_t> merge() {
+            std::array<Table<Key, State>, PARTITIONS> merged;
+            std::atomic<size_t> next_partition = 0;
+            run_workers(threads, [&](unsigned) {
+                for (size_t p; (p = next_partition++) < PARTITIONS;) {
+                    auto& target = merged[p];
+                    target = std::move(locals[0].partitions[p]);
+                    for (auto w = 1u; w < locals.size(); ++w) {
+                        for (auto& group : locals[w].partitions[p].groups) {
+                            merge_state(target.find_or_insert(group.key, group.hash), group.state);
+                        }
+                    }
+                }
+            });
+            locals.assign(threads, {});
+            size_t total = 0;
+            for (auto& partition : merged) {
+                total += partition.size();
+            }
+            std::vector<group_t> result;
+            result.reserve(total);
+            for (auto& partition : merged) {
+                for (auto& group : partition.groups) {
+                    result.emplace_back(std::move(group.key), std::move(group.state));
+                }
+            }
+            return result;
+        }
+
+    private:
+        unsigned threads;
+        std::vector<LocalTable<Key, State>> locals;
+    };
+
+    /// Common states; types.hpp values are not zero-initialized by default.
+    template <typename T>
+    struct Sum {
+        T value = T(0);
+
+        inline void add(const T& v) { value += v; }
+        inline void merge(const Sum& other) { value += other.value; }
+    };
+
+    struct Count {
+        uint64_t value = 0;
+
+        inline void add() { ++value; }
+        inline void merge(const Count& other) { value += other.value; }
+    };
+
+    template <typename T>
+    struct Min {
+        std::optional<T> value;
+
+        inline void add(const T& v) {
+            if (!value || v < *value) {
+                value = v;
+            }
+        }
+        inline void merge(const Min& other) {
+            if (other.value) {
+                add(*other.value);
+            }
+        }
+    };
+
+    template <typename T>
+    struct Max {
+        std::optional<T> value;
+
+        inline void add(const T& v) {
+            if (!value || *value < v) {
+                value = v;
+            }
+        }
+        inline void merge(const Max& other) {
+            if (other.value) {
+                add(*other.value);
+            }
+        }
+    };
+
+} // namespace aggregate
@@ -1,63 +1,144 @@
 #include "csv-read/csv.hpp"
 #include "common.hpp"
 #include "tpch.hpp"
+#include "manifest.hpp"
+#include "refresh.hpp"
 
 #include <iostream>
 #include <array>
+#include <chrono>
 #include <string_view>
 
 
-int main(int argc, char *argv[]) {
-    auto cfg = read_config();
-    auto iprefix = cfg.input;
-    // nation
-    {
-      tpch::nation::reader reader("output/nation/", (iprefix + "nation.tbl").c_str());
-      auto rows = reader.read();
-      std::cout << "read " << rows << " rows for nation" << std::endl;
+// converted tables, their manifests are written once all outputs are complete
+struct Converted {
+    std::string dir;
+    manifest::Check check;
+    unsigned rows;
+    std::span<const char* const> columns;
+};
+
+// returns false if the table had errors and was not written
+template <typename table>
+bool convert_table(const RunConfig& cfg, const std::string& name, std::span<const char* const> columns,
+                   std::vector<Converted>& converted) {
+    auto dir = cfg.output + name + "/";
+    auto input = cfg.input + name + ".tbl";
+    auto options = cfg.table_options(name, columns);
+    auto monitor = options.monitor;
+    auto input_bytes = monitor ? std::filesystem::file_size(input) : 0;
+    manifest::Check check(input, dir, options.fingerprint(), options.threads, cfg.force);
+    if (check.up_to_date) {
+      if (monitor) {
+        monitor->end_table(input_bytes);
+      }
+      check.refresh(dir);
+      std::cout << "skipping " << name << ", " << check.previous.rows << " rows unchanged" << std::endl;
+      return true;
     }
-    // customer
-    {
-      tpch::customer::reader reader("output/customer/", (iprefix + "customer.tbl").c_str());
-      auto rows = reader.read();
-      std::cout << "read " << rows << " rows for customer" << std::endl;
+    check.invalidate(dir);
+    if (name == "orders" || name == "lineitem") {
+      // deltas and deletions of the old base do not apply to the new one
+      refresh::discard(cfg.output, dir);
     }
-    // lineitem
-    {
-      tpch::lineitem::reader reader("output/lineitem/", (iprefix + "lineitem.tbl").c_str());
-      auto rows = reader.read();
-      std::cout << "read " << rows << " rows for lineitem" << std::endl;
+    auto before = memory::Usage::now();
+    auto reused_before = memory::Pool::get().reused();
+    auto start = std::chrono::steady_clock::now();
+    unsigned rows;
+    long huge_kb;
+    bool failed;
+    if (monitor) {
+      monitor->begin_table(name, input_bytes);
     }
-    // orders
     {
-      tpch::orders::reader reader("output/orders/", (iprefix + "orders.tbl").c_str());
-      auto rows = reader.read();
-      std::cout << "read " << rows << " rows for orders" << std::endl;
+      typename table::reader reader(dir, input.c_str(), options);
+      rows = reader.read();
+      if (monitor) {
+        monitor->begin_write();
+      }
+      if (reader.report.count) {
+        reader.report.print(std::cerr, name, columns);
+      }
+      failed = reader.failed;
+      // staging buffers are released with the reader
+      huge_kb = memory::Usage::anon_huge_kb();
     }
-    // part
-    {
-     tpch::part::reader reader("output/part/", (iprefix + "part.tbl").c_str());
-      auto rows = reader.read();
-      std::cout << "read " << rows << " rows for part" << std::endl;
+    if (monitor) {
+      monitor->end_table(input_bytes);
     }
-    // partsupp
-    {
-     tpch::partsupp::reader reader("output/partsupp/", (iprefix + "partsupp.tbl").c_str());
-      auto rows = reader.read();
-      std::cout << "read " << rows << " rows for partsupp" << std::endl;
+    if (failed) {
+      return false;
     }
-    // region
-    {
-      tpch::region::reader reader("output/region/", (iprefix + "region.tbl").c_str());
-      auto rows = reader.read();
-      std::cout << "read " << rows << " rows for region" << std::endl;
-    }
-    // supplier
-    {
-      tpch::supplier::reader reader("output/supplier/", (iprefix + "supplier.tbl").c_str());
-      auto rows = reader.read();
-      std::cout << "read " << rows << " rows for supplier" << std::endl;
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    auto after = memory::Usage::now();
+    std::cout << "read " << rows << " rows for " << name << " in " << secs.count() << "s"
+              << " (minor faults: " << (after.minor_faults - before.minor_faults)
+              << ", major faults: " << (after.major_faults - before.major_faults)
+              << ", huge pages: " << (huge_kb >> 10) << " MiB"
+              << ", reused buffers: " << ((memory::Pool::get().reused() - reused_before) >> 20) << " MiB)" << std::endl;
+    converted.push_back(Converted{dir, std::move(check), rows, columns});
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    try {
+      auto cfg = read_config();
+      memory::Pool::get().limit = cfg.pool;
+      std::optional<aio::AsyncWriter> writer;
+      if (cfg.writer != "sync") {
+        writer.emplace(cfg.writer_options, cfg.writer == "threads" ? aio::Backend::THREADS : aio::Backend::URING);
+        cfg.options.writer = &*writer;
+      }
+      std::optional<telemetry::Monitor> monitor;
+      if (cfg.telemetry_options.interval > 0) {
+        uint64_t total_bytes = 0;
+        for (auto name : {"nation", "customer", "lineitem", "orders", "part", "partsupp", "region", "supplier"}) {
+          std::error_code error;
+          auto size = std::filesystem::file_size(cfg.input + name + ".tbl", error);
+          total_bytes += error ? 0 : size;
+        }
+        auto workers = cfg.options.pipeline.enabled ? cfg.options.pipeline.parse_threads(cfg.threads) : cfg.threads;
+        monitor.emplace(cfg.telemetry_options, workers, total_bytes, writer ? &*writer : nullptr);
+        cfg.options.monitor = &*monitor;
+      }
+      std::cout << "threads: " << cfg.options.threads << ", numa nodes: " << memory::Topology::get().nodes()
+                << ", huge pages: " << (cfg.options.hugepages ? "on" : "off")
+                << ", writer: " << (writer ? aio::BACKEND_NAMES[static_cast<int>(writer->backend())] : "sync")
+                << (cfg.writer_options.direct ? " (O_DIRECT)" : "") << std::endl;
+      std::vector<Converted> converted;
+      bool ok = true;
+      ok &= convert_table<tpch::nation>(cfg, "nation", tpch::nation_c, converted);
+      ok &= convert_table<tpch::customer>(cfg, "customer", tpch::customer_c, converted);
+      ok &= convert_table<tpch::lineitem>(cfg, "lineitem", tpch::lineitem_c, converted);
+      ok &= convert_table<tpch::orders>(cfg, "orders", tpch::orders_c, converted);
+      ok &= convert_table<tpch::part>(cfg, "part", tpch::part_c, converted);
+      ok &= convert_table<tpch::partsupp>(cfg, "partsupp", tpch::partsupp_c, converted);
+      ok &= convert_table<tpch::region>(cfg, "region", tpch::region_c, converted);
+      ok &= convert_table<tpch::supplier>(cfg, "supplier", tpch::supplier_c, converted);
+      if (writer) {
+        auto start = std::chrono::steady_clock::now();
+        writer->drain();
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        std::cout << "wrote " << writer->files_done() << " files (" << (writer->written() >> 20) << " MiB), waited "
+                  << secs.count() << "s for outstanding writes" << std::endl;
+        if (writer->error()) {
+          std::cerr << "write error: " << strerror(writer->error()) << std::endl;
+          return 1;
+        }
+      }
+      for (auto& table : converted) {
+        // after draining the writer, the column files are complete
+        if (cfg.options.container != container::Mode::OFF) {
+          auto size = container::pack(table.dir, table.rows, table.columns, cfg.options.container != container::Mode::ONLY);
+          std::cout << "packed " << table.dir << container::FILE_NAME << " (" << (size >> 20) << " MiB)" << std::endl;
+        }
+        table.check.commit(table.dir, table.rows);
+      }
+      // io::csv::read_file<'|', '\n', decltype(consume_cell)>(cfg.input.c_str(), nation_cols, consume_cell);
+      return ok ? 0 : 1;
+    } catch (const char* error) {
+      // invalid options, e.g. an unknown column in PROJECT
+      std::cerr << "error: " << error << std::endl;
+      return 1;
     }
-    // io::csv::read_file<'|', '\n', decltype(consume_cell)>(cfg.input.c_str(), nation_cols, consume_cell);
-    return 0;
 }
@@ -0,0 +1,475 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/// Asynchronous file writer. Files are handed over as a small header plus a
+/// body owned by the writer until it is written, so callers can continue
+/// parsing while previous columns are written back. Writes are submitted in
+/// segments through io_uring, or through a pool of pwrite threads if
+/// io_uring is unavailable. With O_DIRECT, segments are staged in aligned
+/// buffers and bypass the page cache.
+namespace aio {
+
+    enum class Backend : uint8_t { URING, THREADS };
+    constexpr char const* BACKEND_NAMES[] = { "io_uring", "threads" };
+
+    struct Options {
+        bool direct = false;
+        unsigned queue_depth = 64;
+        unsigned threads = 4;
+        size_t segment_size = 8 << 20;
+        // staging buffers for O_DIRECT, bounds the memory of in-flight writes
+        unsigned staging_buffers = 16;
+    };
+
+    static constexpr size_t DIRECT_ALIGNMENT = 4096;
+
+    /// Minimal raw io_uring wrapper, only used from the writer thread.
+    class Ring {
+        int fd = -1;
+        unsigned entries = 0;
+        void* sq_ptr = MAP_FAILED;
+        void* cq_ptr = MAP_FAILED;
+        size_t sq_size = 0, cq_size = 0;
+        io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+        unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+        unsigned *cq_head, *cq_tail, *cq_mask;
+        io_uring_cqe* cqes;
+        unsigned pending = 0;
+
+    public:
+        explicit Ring(unsigned depth) {
+            io_uring_params params;
+            memset(&params, 0, sizeof(params));
+            fd = syscall(__NR_io_uring_setup, depth, &params);
+            if (fd < 0) {
+                return;
+            }
+            entries = params.sq_entries;
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single) {
+                sq_size = cq_size = std::max(sq_size, cq_size);
+            }
+            sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            cq_ptr = single ? sq_ptr
+                            : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            sqes = static_cast<io_uring_sqe*>(mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+            if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes == MAP_FAILED) {
+                close(fd);
+                fd = -1;
+                return;
+            }
+            auto sq = static_cast<char*>(sq_ptr);
+            sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            auto cq = static_cast<char*>(cq_ptr);
+            cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        }
+
+        ~Ring() {
+            if (sqes != MAP_FAILED) munmap(sqes, entries * sizeof(io_uring_sqe));
+            if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+            if (sq_ptr != MAP_FAILED) munmap(sq_ptr, sq_size);
+            if (fd >= 0) close(fd);
+        }
+
+        inline bool ok() const { return fd >= 0; }
+        inline bool full() const { return pending == entries; }
+        inline unsigned in_flight() const { return pending; }
+
+        void write(int file, const void* buf, size_t len, uint64_t offset, uint64_t user_data) {
+            unsigned tail = *sq_tail;
+            unsigned idx = tail & *sq_mask;
+            io_uring_sqe* sqe = &sqes[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = file;
+            sqe->addr = reinterpret_cast<uint64_t>(buf);
+            sqe->len = len;
+            sqe->off = offset;
+            sqe->user_data = user_data;
+            sq_array[idx] = idx;
+            __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+            ++pending;
+            syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0);
+        }
+
+        /// Waits for at least `min` completions and calls fn(user_data, res) for each.
+        template <typename F>
+        void reap(unsigned min, const F& fn) {
+            if (min) {
+                syscall(__NR_io_uring_enter, fd, 0, min, IORING_ENTER_GETEVENTS, nullptr, 0);
+            }
+            unsigned head = *cq_head;
+            while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+                auto& cqe = cqes[head & *cq_mask];
+                fn(cqe.user_data, cqe.res);
+                ++head;
+                --pending;
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        }
+    };
+
+    class AsyncWriter {
+        struct File {
+            std::string path;
+            int fd = -1;
+            size_t size = 0;
+            std::string header;
+            std::shared_ptr<const void> owner;
+            const char* body = nullptr;
+            unsigned outstanding = 0;
+        };
+
+        struct Segment {
+            File* file;
+            const char* buf;
+            size_t len;
+            uint64_t offset;
+            // staging buffer index for O_DIRECT, -1 otherwise
+            int staging;
+        };
+
+        Options options;
+        Backend used;
+        std::unique_ptr<Ring> ring;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::unique_ptr<File>> files;
+        std::deque<Segment> segments; // thread pool backend only
+        std::vector<char*> staging;
+        std::vector<int> free_staging;
+        size_t queued_files = 0;
+        bool stopping = false;
+        std::atomic<size_t> bytes_written = 0;
+        std::atomic<size_t> files_written = 0;
+        std::atomic<int> first_error = 0;
+        std::thread submitter;
+        std::vector<std::thread> pool;
+
+    public:
+        explicit AsyncWriter(const Options& options = {}, Backend backend = Backend::URING)
+            : options(options), used(backend) {
+            if (used == Backend::URING) {
+                ring = std::make_unique<Ring>(options.queue_depth);
+                if (!ring->ok()) {
+                    ring.reset();
+                    used = Backend::THREADS;
+                }
+            }
+            if (options.direct) {
+                for (auto i = 0u; i != options.staging_buffers; ++i) {
+                    auto buf = static_cast<char*>(std::aligned_alloc(DIRECT_ALIGNMENT, options.segment_size));
+                    if (!buf) {
+                        for (auto allocated : staging) {
+                            std::free(allocated);
+                        }
+                        throw "cannot allocate O_DIRECT staging buffers";
+                    }
+                    staging.push_back(buf);
+                    free_staging.push_back(i);
+                }
+            }
+            if (used == Backend::THREADS) {
+                for (auto i = 0u; i != options.threads; ++i) {
+                    pool.emplace_back([this]() { pool_loop(); });
+                }
+            }
+            submitter = std::thread([this]() { submit_loop(); });
+        }
+
+        ~AsyncWriter() {
+            drain();
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            cv.notify_all();
+            submitter.join();
+            for (auto& t : pool) {
+                t.join();
+            }
+            for (auto buf : staging) {
+                std::free(buf);
+            }
+        }
+
+        inline Backend backend() const { return used; }
+        inline size_t written() const { return bytes_written; }
+        inline size_t files_done() const { return files_written; }
+        inline int error() const { return first_error; }
+
+        /// Writes `header` followed by `body_size` bytes of `body` to `path`.
+        /// `owner` keeps the body alive until the file is written.
+        void write(const std::string& path, std::string header, std::shared_ptr<const void> owner,
+                   const char* body, size_t body_size) {
+            auto file = std::make_unique<File>();
+            file->path = path;
+            file->size = header.size() + body_size;
+            file->header = std::move(header);
+            file->owner = std::move(owner);
+            file->body = body;
+            {
+                std::lock_guard lock(mutex);
+                files.push_back(std::move(file));
+                ++queued_files;
+            }
+            cv.notify_all();
+        }
+
+        /// Blocks until all handed over files are written and closed.
+        void drain() {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [&]() { return queued_files == 0; });
+        }
+
+    private:
+        // bytes [from, to) of the file image header + body
+        void copy_image(const File& file, char* dst, size_t from, size_t to) {
+            if (from < file.header.size()) {
+                auto n = std::min(to, file.header.size()) - from;
+                memcpy(dst, file.header.data() + from, n);
+                dst += n;
+                from += n;
+            }
+            if (from < to) {
+                memcpy(dst, file.body + (from - file.header.size()), to - from);
+            }
+        }
+
+        int acquire_staging() {
+            std::unique_lock lock(mutex);
+            if (free_staging.empty() && ring) {
+                // staging buffers are returned by completions on this thread
+                lock.unlock();
+                while (free_staging.empty()) {
+                    reap(1);
+                }
+                lock.lock();
+            }
+            cv.wait(lock, [&]() { return !free_staging.empty(); });
+            auto idx = free_staging.back();
+            free_staging.pop_back();
+            return idx;
+        }
+
+        void submit_loop() {
+            while (true) {
+                std::unique_ptr<File> next;
+                {
+                    std::unique_lock lock(mutex);
+                    cv.wait_for(lock, std::chrono::milliseconds(ring && ring->in_flight() ? 1 : 100),
+                                [&]() { return stopping || !files.empty(); });
+                    if (files.empty()) {
+                        lock.unlock();
+                        if (ring) reap(0);
+                        if (stopping && (!ring || !ring->in_flight())) return;
+                        continue;
+                    }
+                    next = std::move(files.front());
+                    files.pop_front();
+                }
+                submit_file(next.release());
+            }
+        }
+
+        void submit_file(File* file) {
+            int flags = O_CREAT | O_TRUNC | O_WRONLY | (options.direct ? O_DIRECT : 0);
+            file->fd = ::open(file->path.c_str(), flags, 0644);
+            if (file->fd < 0 && options.direct) {
+                // file system without O_DIRECT support
+                file->fd = ::open(file->path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+            }
+            if (file->fd < 0) {
+                fail(errno);
+                finish(file);
+                return;
+            }
+            {
+                std::lock_guard lock(mutex);
+                file->outstanding = 1; // released below once all segments are out
+            }
+            if (options.direct) {
+                auto aligned = (file->size + DIRECT_ALIGNMENT - 1) & ~(DIRECT_ALIGNMENT - 1);
+                for (size_t off = 0; off < aligned; off += options.segment_size) {
+                    auto idx = acquire_staging();
+                    auto end = std::min(file->size, off + options.segment_size);
+                    copy_image(*file, staging[idx], off, end);
+                    auto len = std::min(aligned, off + options.segment_size) - off;
+                    memset(staging[idx] + (end - off), 0, len - (end - off));
+                    submit(Segment{file, staging[idx], len, off, idx});
+                }
+            } else {
+                if (!file->header.empty()) {
+                    submit(Segment{file, file->header.data(), file->header.size(), 0, -1});
+                }
+                auto body_size = file->size - file->header.size();
+                for (size_t off = 0; off < body_size; off += options.segment_size) {
+                    auto len = std::min(options.segment_size, body_size - off);
+                    submit(Segment{file, file->body + off, len, file->header.size() + off, -1});
+                }
+            }
+            complete(file);
+        }
+
+        void submit(Segment segment) {
+            {
+                std::lock_guard lock(mutex);
+                ++segment.file->outstanding;
+            }
+            if (ring) {
+                while (ring->full()) {
+                    reap(1);
+                }
+                ring->write(segment.file->fd, segment.buf, segment.len, segment.offset,
+                            reinterpret_cast<uint64_t>(new Segment(segment)));
+            } else {
+                {
+                    std::lock_guard lock(mutex);
+                    segments.push_back(segment);
+                }
+                cv.notify_all();
+            }
+        }
+
+        void reap(unsigned min) {
+            // submitting may reap again, so the rest of short writes is only
+            // submitted once the ring has consumed this batch of completions
+            std::vector<std::pair<Segment, size_t>> short_writes;
+            ring->reap(min, [&](uint64_t user_data, int res) {
+                std::unique_ptr<Segment> segment(reinterpret_cast<Segment*>(user_data));
+                if (res < 0) {
+                    fail(-res);
+                } else if (static_cast<size_t>(res) < segment->len) {
+                    short_writes.emplace_back(*segment, res);
+                    return;
+                }
+                done(*segment);
+            });
+            for (auto& [segment, written] : short_writes) {
+                bytes_written += written;
+                Segment rest{segment.file, segment.buf + written, segment.len - written, segment.offset + written, segment.staging};
+                if (options.direct) {
+                    // the rest is no longer aligned for O_DIRECT
+                    write_buffered(rest);
+                    done(rest);
+                } else {
+                    submit(rest);
+                    complete(segment.file);
+                }
+            }
+        }
+
+        // writes a segment synchronously through the page cache
+        void write_buffered(const Segment& segment) {
+            auto flags = fcntl(segment.file->fd, F_GETFL);
+            if (flags >= 0 && (flags & O_DIRECT)) {
+                fcntl(segment.file->fd, F_SETFL, flags & ~O_DIRECT);
+            }
+            for (size_t done = 0; done < segment.len;) {
+                auto res = ::pwrite(segment.file->fd, segment.buf + done, segment.len - done, segment.offset + done);
+                if (res < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (res <= 0) {
+                    fail(res < 0 ? errno : EIO);
+                    return;
+                }
+                done += res;
+            }
+        }
+
+        void pool_loop() {
+            while (true) {
+                Segment segment;
+                {
+                    std::unique_lock lock(mutex);
+                    cv.wait(lock, [&]() { return stopping || !segments.empty(); });
+                    if (segments.empty()) return;
+                    segment = segments.front();
+                    segments.pop_front();
+                }
+                for (size_t done = 0; done < segment.len;) {
+                    auto res = ::pwrite(segment.file->fd, segment.buf + done, segment.len - done, segment.offset + done);
+                    if (res < 0) {
+                        if (errno == EINTR) continue;
+                        fail(errno);
+                        break;
+                    }
+                    done += res;
+                }
+                done(segment);
+            }
+        }
+
+        void done(const Segment& segment) {
+            bytes_written += segment.len;
+            if (segment.staging >= 0) {
+                {
+                    std::lock_guard lock(mutex);
+                    free_staging.push_back(segment.staging);
+                }
+                cv.notify_all();
+            }
+            complete(segment.file);
+        }
+
+        void complete(File* file) {
+            {
+                std::lock_guard lock(mutex);
+                if (--file->outstanding != 0) {
+                    return;
+                }
+            }
+            finish(file);
+        }
+
+        void finish(File* file) {
+            if (file->fd >= 0) {
+                if (options.direct && ftruncate(file->fd, file->size) != 0) {
+                    fail(errno);
+                }
+                close(file->fd);
+            }
+            ++files_written;
+            delete file;
+            {
+                std::lock_guard lock(mutex);
+                --queued_files;
+            }
+            cv.notify_all();
+        }
+
+        void fail(int err) {
+            int expected = 0;
+            first_error.compare_exchange_strong(expected, err);
+        }
+    };
+
+} // namespace aio
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "types.hpp"
+#include "narrow.hpp"
+#include "hash-batch.hpp"
+
+/// Per-block split-block Bloom filters on key columns. Every block of
+/// BLOCK_ROWS rows gets its own filter of 256-bit buckets. A key sets one
+/// bit in each of the eight 32-bit words of the bucket chosen by the high
+/// half of its hash, the bit positions come from the low half multiplied
+/// with eight odd salts (the Parquet layout). A probe is a single bucket
+/// load and one vector test. The file <idx>.<type>.bloom.bin is a
+/// DataColumn<uint64_t> of
+///   rows, block rows, blocks,
+///   per block: data offset in words, buckets,
+///   filter data, four words per bucket.
+/// Keys are hashed with hashing::hash_int, which does not depend on the
+/// instruction set, so the filters can be persisted.
+namespace bloom {
+
+    static constexpr uint64_t BLOCK_ROWS = narrow::BLOCK_ROWS;
+    static constexpr uint64_t HEADER_WORDS = 3;
+    static constexpr uint64_t DIRECTORY_WORDS = 2;
+    static constexpr uint64_t BUCKET_WORDS = 4;
+    // about 1% false positives for distinct keys
+    static constexpr uint64_t BITS_PER_KEY = 10;
+
+    alignas(32) constexpr uint32_t SALTS[8] = {0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+                                               0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+
+    /// Key columns the filters are built for.
+    template <typename T>
+    concept key_column = hashing::integer_key<T>;
+
+    template <key_column T>
+    inline uint64_t key_hash(const T& key) {
+        return hashing::hash(key);
+    }
+
+    inline uint64_t buckets_for(uint64_t rows) {
+        return std::max<uint64_t>(1, (rows * BITS_PER_KEY + 255) / 256);
+    }
+
+    inline uint64_t bucket_of(uint64_t hash, uint64_t buckets) {
+        return ((hash >> 32) * buckets) >> 32;
+    }
+
+#ifdef __AVX2__
+    inline __m256i bucket_mask(uint64_t hash) {
+        __m256i bits = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<uint32_t>(hash)),
+                                          _mm256_load_si256(reinterpret_cast<const __m256i*>(SALTS)));
+        return _mm256_sllv_epi32(_mm256_set1_epi32(1), _mm256_srli_epi32(bits, 27));
+    }
+#endif
+
+    inline void insert(uint64_t* filter, uint64_t buckets, uint64_t hash) {
+        auto words = reinterpret_cast<uint32_t*>(filter + bucket_of(hash, buckets) * BUCKET_WORDS);
+        for (auto i = 0; i != 8; ++i) {
+            words[i] |= 1u << ((static_cast<uint32_t>(hash) * SALTS[i]) >> 27);
+        }
+    }
+
+    /// The filter of one block.
+    struct Filter {
+        const uint64_t* data;
+        uint64_t buckets;
+
+        inline bool may_contain(uint64_t hash) const {
+            auto bucket = data + bucket_of(hash, buckets) * BUCKET_WORDS;
+#ifdef __AVX2__
+            return _mm256_testc_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bucket)), bucket_mask(hash));
+#else
+            auto words = reinterpret_cast<const uint32_t*>(bucket);
+            for (auto i = 0; i != 8; ++i) {
+                if (!((words[i] >> ((static_cast<uint32_t>(hash) * SALTS[i]) >> 27)) & 1)) {
+                    return false;
+                }
+            }
+            return true;
+#endif
+        }
+
+        /// Does any of the hashes possibly occur in the block?
+        inline bool may_contain_any(const uint64_t* hashes, size_t count) const {
+            for (size_t i = 0; i != count; ++i) {
+                if (may_contain(hashes[i])) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Stores the positions of the hashes that may occur in the block in
+        /// `selection` and returns their number.
+        inline size_t select(const uint64_t* hashes, size_t count, uint32_t* selection) const {
+            size_t selected = 0;
+            for (size_t i = 0; i != count; ++i) {
+                selection[selected] = i;
+                selected += may_contain(hashes[i]);
+            }
+            return selected;
+        }
+    };
+
+    /// Number of words of the filter file for `rows` keys.
+    inline uint64_t layout(size_t rows) {
+        auto blocks = (rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        uint64_t words = HEADER_WORDS + blocks * DIRECTORY_WORDS;
+        for (auto block = 0ul; block != blocks; ++block) {
+            words += buckets_for(std::min<uint64_t>(rows - block * BLOCK_ROWS, BLOCK_ROWS)) * BUCKET_WORDS;
+        }
+        return words;
+    }
+
+    /// Writes the filters of `keys` into `out`, which holds the number of
+    /// words returned by `layout` and is zeroed.
+    template <key_column T>
+    void encode(const T* keys, size_t rows, uint64_t* out) {
+        auto blocks = (rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        out[0] = rows;
+        out[1] = BLOCK_ROWS;
+        out[2] = blocks;
+        uint64_t* directory = out + HEADER_WORDS;
+        uint64_t* data = directory + blocks * DIRECTORY_WORDS;
+        uint64_t offset = 0;
+        std::vector<uint64_t> hashes(BLOCK_ROWS);
+        for (auto block = 0ul; block != blocks; ++block) {
+            auto begin = block * BLOCK_ROWS, count = std::min<uint64_t>(rows - begin, BLOCK_ROWS);
+            auto buckets = buckets_for(count);
+            directory[block * DIRECTORY_WORDS] = offset;
+            directory[block * DIRECTORY_WORDS + 1] = buckets;
+            hashing::hash_column(keys + begin, count, hashes.data());
+            for (auto i = 0ul; i != count; ++i) {
+                insert(data + offset, buckets, hashes[i]);
+            }
+            offset += buckets * BUCKET_WORDS;
+        }
+    }
+
+} // namespace bloom
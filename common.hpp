@@ -6,30 +6,277 @@
 #include <vector>
 #include <array>
 #include <utility>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstring>
+#include <cerrno>
 #include <filesystem>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <string_view>
+#include <optional>
+#include <span>
+#include <functional>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
 #include "csv-read/csv.hpp"
 #include "csv-read/util.hpp"
+#include "types-format.hpp"
+#include "memory.hpp"
+#include "async-writer.hpp"
+#include "narrow.hpp"
+#include "bloom.hpp"
+#include "telemetry.hpp"
+#include "pipeline.hpp"
+#include "container.hpp"
+#include "ingest-errors.hpp"
 
 using CharIter = io::csv::CharIter;
 static constexpr char delim = '|';
+struct ConvertOptions {
+    // write string columns as InlineString headers plus heap
+    bool inline_strings = false;
+    // parsing threads, 1 uses the sequential csv reader
+    unsigned threads = 1;
+    // transparent huge pages for the input mapping and staging buffers
+    bool hugepages = false;
+    // write fixed-size columns in the background instead of flushing them
+    aio::AsyncWriter* writer = nullptr;
+    // workers publish their progress here if set
+    telemetry::Monitor* monitor = nullptr;
+    // convert in batches through the stages of pipeline.hpp
+    pipeline::Options pipeline;
+    // store Numeric and Date columns in the narrowest width per block
+    bool narrow = false;
+    // pack the column files of a table into one file, see container.hpp
+    container::Mode container = container::Mode::OFF;
+    // one bit per column, other columns are skipped without parsing them
+    uint64_t projection = ~0ull;
+    // one bit per column, key columns that get per-block Bloom filters
+    uint64_t bloom = 0;
+    // keep only rows with filter_low <= value <= filter_high in this column,
+    // an empty bound is open
+    int filter_column = -1;
+    std::string filter_low;
+    std::string filter_high;
+    // fraction of rows to keep, chosen by a hash of the key in sample_column
+    // or, without one, of the row number
+    double sample = 1.0;
+    int sample_column = -1;
+    uint64_t sample_seed = 0;
+    // what to do with malformed fields, see ingest-errors.hpp
+    ingest::Policy errors = ingest::Policy::STOP;
+    // parse with the validating parallel reader even on one thread
+    bool validate = false;
+
+    inline bool projected(unsigned column) const { return (projection >> column) & 1; }
+    inline bool bloomed(unsigned column) const { return (bloom >> column) & 1; }
+    inline bool filtered() const { return filter_column >= 0; }
+    inline bool sampled() const { return sample < 1.0; }
+
+    // rows are kept if their hash is below this
+    inline uint64_t sample_threshold() const {
+      return sample <= 0 ? 0 : static_cast<uint64_t>(std::ldexp(sample, 64));
+    }
+
+    // the options that change the output files, recorded in the manifest
+    std::string fingerprint() const {
+      auto result = std::string("strings=") + (inline_strings ? "inline" : "slots");
+      if (narrow) {
+        result += " narrow";
+      }
+      if (container != container::Mode::OFF) {
+        result += container == container::Mode::ONLY ? " container=only" : " container";
+      }
+      if (projection != ~0ull) {
+        result += " columns=" + std::to_string(projection);
+      }
+      if (bloom) {
+        result += " bloom=" + std::to_string(bloom);
+      }
+      if (filtered()) {
+        result += " filter=" + std::to_string(filter_column) + ":" + filter_low + ".." + filter_high;
+      }
+      if (sampled()) {
+        result += " sample=" + std::to_string(sample) + ":" + std::to_string(sample_column) + ":" + std::to_string(sample_seed);
+      }
+      if (errors != ingest::Policy::STOP) {
+        result += std::string(" errors=") + ingest::POLICY_NAMES[static_cast<int>(errors)];
+      }
+      return result;
+    }
+};
+
 struct RunConfig {
     std::string input;
+    std::string output = "output/";
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    // sync, uring or threads
+    std::string writer = "sync";
+    aio::Options writer_options;
+    telemetry::Options telemetry_options;
+    // convert all tables even if their manifest is up to date
+    bool force = false;
+    // per table projections, e.g. "lineitem=l_orderkey,l_shipdate;orders=o_orderkey"
+    std::string project;
+    // per table range filters, e.g. "lineitem.l_shipdate=1995-01-01..1995-12-31"
+    std::string filter;
+    // per table sampling keys, e.g. "lineitem=l_orderkey;orders=o_orderkey"
+    std::string sample_key;
+    // per table Bloom filter keys, e.g. "lineitem=l_orderkey,l_partkey;orders=o_orderkey"
+    std::string bloom;
+    // bytes of staging buffers the converters keep for the next table, see
+    // memory::Pool
+    size_t pool = memory::Pool::default_limit();
+    ConvertOptions options;
+
+    /// The options for one table with its PROJECT, FILTER, SAMPLE_KEY and
+    /// BLOOM entries applied.
+    ConvertOptions table_options(std::string_view table, std::span<const char* const> columns) const {
+      auto result = options;
+      auto column_index = [&](std::string_view name) {
+        for (auto idx = 0u; idx != columns.size(); ++idx) {
+          if (name == columns[idx]) {
+            return idx;
+          }
+        }
+        throw "unknown column in PROJECT, FILTER, SAMPLE_KEY or BLOOM";
+      };
+      for_each_entry(project, [&](std::string_view entry) {
+        auto eq = entry.find('=');
+        if (entry.substr(0, eq) != table || eq == std::string_view::npos) {
+          return;
+        }
+        result.projection = 0;
+        for_each_entry(entry.substr(eq + 1), [&](std::string_view name) {
+          result.projection |= 1ull << column_index(name);
+        }, ',');
+      });
+      for_each_entry(filter, [&](std::string_view entry) {
+        auto dot = entry.find('.'), eq = entry.find('='), range = entry.find("..", eq);
+        if (entry.substr(0, dot) != table || eq == std::string_view::npos || range == std::string_view::npos) {
+          return;
+        }
+        result.filter_column = column_index(entry.substr(dot + 1, eq - dot - 1));
+        result.filter_low = entry.substr(eq + 1, range - eq - 1);
+        result.filter_high = entry.substr(range + 2);
+      });
+      for_each_entry(sample_key, [&](std::string_view entry) {
+        auto eq = entry.find('=');
+        if (entry.substr(0, eq) == table && eq != std::string_view::npos) {
+          result.sample_column = column_index(entry.substr(eq + 1));
+        }
+      });
+      for_each_entry(bloom, [&](std::string_view entry) {
+        auto eq = entry.find('=');
+        if (entry.substr(0, eq) != table || eq == std::string_view::npos) {
+          return;
+        }
+        for_each_entry(entry.substr(eq + 1), [&](std::string_view name) {
+          result.bloom |= 1ull << column_index(name);
+        }, ',');
+      });
+      return result;
+    }
+
+private:
+    template <typename F>
+    static void for_each_entry(std::string_view list, const F& fn, char separator = ';') {
+      while (!list.empty()) {
+        auto end = std::min(list.find(separator), list.size());
+        if (end) {
+          fn(list.substr(0, end));
+        }
+        list.remove_prefix(std::min(end + 1, list.size()));
+      }
+    }
 };
 
 
 RunConfig read_config() {
   auto file = getenv("INPUT");
   assert(file);
-  return RunConfig{.input = file};
+  RunConfig cfg{.input = file};
+  if (auto output = getenv("OUTPUT")) { cfg.output = output; }
+  if (auto threads = getenv("THREADS")) { cfg.threads = std::max(1, atoi(threads)); }
+  if (auto strings = getenv("STRINGS")) { cfg.options.inline_strings = std::string_view(strings) == "inline"; }
+  if (auto huge = getenv("HUGEPAGES")) { cfg.options.hugepages = atoi(huge) != 0; }
+  if (auto pool = getenv("POOL")) { cfg.pool = strtoull(pool, nullptr, 10) << 20; }
+  if (auto narrow = getenv("NARROW")) { cfg.options.narrow = atoi(narrow) != 0; }
+  if (auto packed = getenv("CONTAINER")) { cfg.options.container = container::parse_mode(packed); }
+  if (auto writer = getenv("WRITER")) { cfg.writer = writer; }
+  if (auto direct = getenv("DIRECT")) { cfg.writer_options.direct = atoi(direct) != 0; }
+  if (auto interval = getenv("TELEMETRY")) { cfg.telemetry_options.interval = std::max(0.0, atof(interval)); }
+  if (auto file = getenv("TELEMETRY_FILE")) { cfg.telemetry_options.file = file; }
+  if (auto socket = getenv("TELEMETRY_SOCKET")) { cfg.telemetry_options.socket = socket; }
+  if (auto stages = getenv("PIPELINE")) { cfg.options.pipeline = pipeline::parse_options(stages); }
+  if (auto force = getenv("FORCE")) { cfg.force = atoi(force) != 0; }
+  if (auto project = getenv("PROJECT")) { cfg.project = project; }
+  if (auto filter = getenv("FILTER")) { cfg.filter = filter; }
+  if (auto sample = getenv("SAMPLE")) { cfg.options.sample = std::clamp(atof(sample), 0.0, 1.0); }
+  if (auto sample_key = getenv("SAMPLE_KEY")) { cfg.sample_key = sample_key; }
+  if (auto bloom = getenv("BLOOM")) { cfg.bloom = bloom; }
+  if (auto seed = getenv("SEED")) { cfg.options.sample_seed = strtoull(seed, nullptr, 10); }
+  if (auto errors = getenv("ERRORS")) {
+    cfg.options.errors = ingest::parse_policy(errors);
+    cfg.options.validate = true;
+  }
+  cfg.options.threads = cfg.threads;
+  memory::use_hugepages = cfg.options.hugepages;
+  return cfg;
 }
 
+// runs fn(worker_id) on `threads` threads and waits for all of them
+template <typename F>
+void run_workers(unsigned threads, const F& fn) {
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  for (auto id = 0u; id != threads; ++id) {
+    workers.emplace_back([&fn, id]() { fn(id); });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+template <typename T>
+std::string column_file(const std::string& prefix, unsigned idx) {
+  using parser_t = io::csv::Parser<T>;
+  return prefix + std::to_string(idx) + "." + parser_t::TYPE_NAME + ".bin";
+}
+
+// the header a fixed-size column file of `size` bytes starts with, for files
+// that are written without mapping them
+template <typename page_t>
+std::string column_header(size_t size) requires (!page_t::size_tag::IS_VARIABLE) {
+  using header_t = std::remove_pointer_t<decltype(std::declval<const page_t&>().data())>;
+  using value_t = std::remove_reference_t<decltype(*std::declval<const page_t&>().begin())>;
+  static_assert(sizeof(header_t) == page_t::GLOBAL_OVERHEAD);
+  header_t header{};
+  header.count = (size - page_t::GLOBAL_OVERHEAD) / sizeof(value_t);
+  return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+// auxiliary files of a column are named <idx>.<type>.<kind>.bin
+inline std::string column_sibling(const std::string& column_file, const char* kind) {
+  return column_file.substr(0, column_file.size() - 4) + "." + kind + ".bin";
+}
+
+// string columns that can be written in the InlineString layout
+template <typename T>
+concept inline_string_column = requires { T::MAX_LEN; } && (T::MAX_LEN > 1);
+
 template<typename T>
 struct ColumnOutput {
   using value_t = T;
   using page_t = io::DataColumn<T>;
 
   uintptr_t output_size;
-  std::vector<T> items;
+  std::vector<T, memory::StagingAllocator<T>> items;
 
   ColumnOutput(unsigned expected_rows = 1024) : output_size(page_t::GLOBAL_OVERHEAD), items() {
     items.reserve(expected_rows);
@@ -49,6 +296,46 @@ struct ColumnOutput {
     return true;
   }
 
+  // sizes the buffer for `rows` values up front, growing it later copies
+  // every value into a buffer twice as large
+  void reserve(size_t rows) {
+    items.reserve(rows);
+  }
+
+  // makes room for `rows` values which are then filled with `set`
+  void resize(size_t rows) {
+    items.resize(rows);
+  }
+
+  // stores a value at a resized position, returns its contribution to output_size
+  inline uintptr_t set(size_t row, const T& val) {
+    items[row] = val;
+    if constexpr (page_t::size_tag::IS_VARIABLE) {
+      return val.size() + page_t::PER_ITEM_OVERHEAD;
+    } else {
+      return sizeof(T);
+    }
+  }
+
+  // moves `count` rows from `from` down to `to` when filtered rows are dropped
+  void move_rows(size_t from, size_t to, size_t count) {
+    std::copy(items.begin() + from, items.begin() + from + count, items.begin() + to);
+  }
+
+  void truncate(size_t rows) {
+    items.resize(rows);
+  }
+
+  // appends the first `rows` values of a pipeline batch, `size` is their
+  // contribution to output_size
+  void append_rows(const ColumnOutput& batch, size_t rows, uintptr_t size) {
+    items.insert(items.end(), batch.items.begin(), batch.items.begin() + rows);
+    output_size += size;
+  }
+
+  // forgets the values of a skipped row before the next row is stored there
+  inline void clear_row(size_t) {}
+
   page_t make_page(const char* filename) const {
     auto page = page_t(filename, O_CREAT, output_size);
     if constexpr (page_t::size_tag::IS_VARIABLE) {
@@ -66,8 +353,250 @@ struct ColumnOutput {
     }
     return page;
   }
+
+  // writes <idx>.<type>.inline.bin with one header per string and
+  // <idx>.<type>.heap.bin with all strings that do not fit inline
+  void write_inline(const std::string& filename) const requires inline_string_column<T> {
+    using header_page_t = io::DataColumn<types::InlineString>;
+    using heap_page_t = io::DataColumn<char>;
+    size_t heap_size = 0;
+    for (auto& str : items) {
+      heap_size += str.length() > types::InlineString::INLINE_LEN ? str.length() : 0;
+    }
+    header_page_t headers(column_sibling(filename, "inline").c_str(), O_CREAT,
+                          header_page_t::GLOBAL_OVERHEAD + items.size() * sizeof(types::InlineString));
+    heap_page_t heap(column_sibling(filename, "heap").c_str(), O_CREAT, heap_page_t::GLOBAL_OVERHEAD + heap_size);
+    auto header = headers.begin();
+    char* heap_data = heap.begin();
+    uint64_t offset = 0;
+    for (auto& str : items) {
+      *header++ = types::InlineString::build(str.begin(), str.length(), offset);
+      if (str.length() > types::InlineString::INLINE_LEN) {
+        std::copy(str.begin(), str.end(), heap_data + offset);
+        offset += str.length();
+      }
+    }
+    headers.flush();
+    heap.flush();
+  }
+
+  // writes <idx>.<type>.narrow.bin, see narrow.hpp
+  void write_narrow(const std::string& filename) const requires narrow::narrowable<T> {
+    using narrow_page_t = io::DataColumn<uint64_t>;
+    std::vector<narrow::BlockInfo> blocks;
+    auto words = narrow::layout(items.data(), items.size(), blocks);
+    narrow_page_t page(column_sibling(filename, "narrow").c_str(), O_CREAT, narrow_page_t::GLOBAL_OVERHEAD + words * sizeof(uint64_t));
+    narrow::encode(items.data(), items.size(), blocks, page.begin());
+    page.flush();
+  }
+
+  // writes <idx>.<type>.bloom.bin, see bloom.hpp
+  void write_bloom(const std::string& filename) const requires bloom::key_column<T> {
+    using bloom_page_t = io::DataColumn<uint64_t>;
+    auto words = bloom::layout(items.size());
+    bloom_page_t page(column_sibling(filename, "bloom").c_str(), O_CREAT, bloom_page_t::GLOBAL_OVERHEAD + words * sizeof(uint64_t));
+    std::fill_n(page.begin(), words, 0);
+    bloom::encode(items.data(), items.size(), page.begin());
+    page.flush();
+  }
+
+  // hands the header and the values to the asynchronous writer
+  void write_async(aio::AsyncWriter& writer, const std::string& filename) requires (!page_t::size_tag::IS_VARIABLE) {
+    auto header = column_header<page_t>(output_size);
+    auto owner = std::make_shared<decltype(items)>(std::move(items));
+    auto body = reinterpret_cast<const char*>(owner->data());
+    writer.write(filename, std::move(header), owner, body, owner->size() * sizeof(T));
+  }
 };
 
+/// Nullable columns store their values like the non-null column and
+/// additionally track NULLs in a lazily allocated bitmap. Only blocks that
+/// contain NULLs are written to the validity file, which is omitted
+/// altogether if the column has no NULLs.
+template<typename T>
+struct ColumnOutput<types::Nullable<T>> : ColumnOutput<T> {
+  using value_t = types::Nullable<T>;
+  using validity_page_t = io::DataColumn<uint64_t>;
+  static constexpr uint64_t BLOCK_ROWS = 64 * 1024;
+  static constexpr uint64_t BLOCK_WORDS = BLOCK_ROWS / 64;
+  static constexpr uint64_t ALL_VALID = ~0ull;
+  // rows, block rows, block count
+  static constexpr uint64_t HEADER_WORDS = 3;
+
+  // bit set = NULL; empty until the first NULL is appended or resized
+  std::vector<uint64_t> nulls;
+
+  ColumnOutput(unsigned expected_rows = 1024) : ColumnOutput<T>(expected_rows), nulls() {}
+
+  bool append(const value_t& val) {
+    if (val.null) [[unlikely]] {
+      auto row = this->items.size();
+      if (nulls.size() <= row / 64) {
+        nulls.resize(row / 64 + 1);
+      }
+      nulls[row / 64] |= 1ull << (row % 64);
+    }
+    return ColumnOutput<T>::append(val.value);
+  }
+
+  void resize(size_t rows) {
+    ColumnOutput<T>::resize(rows);
+    nulls.assign(rows / 64 + 1, 0);
+  }
+
+  // workers share the bitmap words at chunk boundaries
+  inline uintptr_t set(size_t row, const value_t& val) {
+    if (val.null) [[unlikely]] {
+      __atomic_fetch_or(&nulls[row / 64], 1ull << (row % 64), __ATOMIC_RELAXED);
+    }
+    return ColumnOutput<T>::set(row, val.value);
+  }
+
+  void move_rows(size_t from, size_t to, size_t count) {
+    ColumnOutput<T>::move_rows(from, to, count);
+    for (auto row = 0ul; row != count; ++row) {
+      auto bit = 1ull << ((to + row) % 64);
+      nulls[(to + row) / 64] = is_null(from + row) ? nulls[(to + row) / 64] | bit : nulls[(to + row) / 64] & ~bit;
+    }
+  }
+
+  void truncate(size_t rows) {
+    ColumnOutput<T>::truncate(rows);
+    nulls.resize(rows / 64 + 1);
+    nulls.back() &= (1ull << (rows % 64)) - 1;
+  }
+
+  void append_rows(const ColumnOutput& batch, size_t rows, uintptr_t size) {
+    auto first = this->items.size();
+    ColumnOutput<T>::append_rows(batch, rows, size);
+    for (auto row = 0ul; row != rows; ++row) {
+      if (batch.is_null(row)) [[unlikely]] {
+        if (nulls.size() <= (first + row) / 64) {
+          nulls.resize((first + row) / 64 + 1);
+        }
+        nulls[(first + row) / 64] |= 1ull << ((first + row) % 64);
+      }
+    }
+  }
+
+  // workers share the bitmap words at chunk boundaries
+  inline void clear_row(size_t row) {
+    __atomic_fetch_and(&nulls[row / 64], ~(1ull << (row % 64)), __ATOMIC_RELAXED);
+  }
+
+  inline bool is_null(size_t row) const {
+    return row / 64 < nulls.size() && (nulls[row / 64] >> (row % 64)) & 1;
+  }
+
+  inline bool has_nulls() const {
+    return std::any_of(nulls.begin(), nulls.end(), [](uint64_t w) { return w != 0; });
+  }
+
+  typename ColumnOutput<T>::page_t make_page(const char* filename) const {
+    update_validity(filename);
+    return ColumnOutput<T>::make_page(filename);
+  }
+
+  void write_inline(const std::string& filename) const requires inline_string_column<T> {
+    update_validity(filename);
+    ColumnOutput<T>::write_inline(filename);
+  }
+
+  void write_narrow(const std::string& filename) const requires narrow::narrowable<T> {
+    update_validity(filename);
+    ColumnOutput<T>::write_narrow(filename);
+  }
+
+  void write_async(aio::AsyncWriter& writer, const std::string& filename) {
+    update_validity(filename);
+    ColumnOutput<T>::write_async(writer, filename);
+  }
+
+private:
+  void update_validity(const std::string& filename) const {
+    auto valid_file = column_sibling(filename, "valid");
+    if (!has_nulls()) {
+      std::filesystem::remove(valid_file);
+    } else {
+      write_validity(valid_file.c_str());
+    }
+  }
+
+  void write_validity(const char* filename) const {
+    auto rows = this->items.size();
+    auto blocks = (rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    auto null_block = [&](uint64_t block) {
+      auto begin = block * BLOCK_WORDS, end = std::min<uint64_t>(nulls.size(), begin + BLOCK_WORDS);
+      return begin < end && std::any_of(nulls.begin() + begin, nulls.begin() + end, [](uint64_t w) { return w != 0; });
+    };
+    uint64_t stored = 0;
+    for (auto block = 0ul; block != blocks; ++block) {
+      stored += null_block(block);
+    }
+    auto words = HEADER_WORDS + blocks + stored * BLOCK_WORDS;
+    validity_page_t page(filename, O_CREAT, validity_page_t::GLOBAL_OVERHEAD + words * sizeof(uint64_t));
+    uint64_t* out = page.begin();
+    out[0] = rows;
+    out[1] = BLOCK_ROWS;
+    out[2] = blocks;
+    uint64_t* directory = out + HEADER_WORDS;
+    uint64_t* bitmaps = directory + blocks;
+    for (auto block = 0ul, next = 0ul; block != blocks; ++block) {
+      if (!null_block(block)) {
+        directory[block] = ALL_VALID;
+        continue;
+      }
+      directory[block] = next;
+      uint64_t* bitmap = bitmaps + next * BLOCK_WORDS;
+      for (auto w = 0ul; w != BLOCK_WORDS; ++w) {
+        auto word = block * BLOCK_WORDS + w;
+        bitmap[w] = ~(word < nulls.size() ? nulls[word] : 0);
+      }
+      ++next;
+    }
+    page.flush();
+  }
+};
+
+// writes a column in the layout selected by the options
+template <typename Output>
+void write_column(Output& output, const std::string& filename, const ConvertOptions& options) {
+  if constexpr (requires { output.write_inline(filename); }) {
+    if (options.inline_strings) {
+      output.write_inline(filename);
+      return;
+    }
+  }
+  if constexpr (requires { output.write_narrow(filename); }) {
+    if (options.narrow) {
+      output.write_narrow(filename);
+      return;
+    }
+  }
+  if constexpr (requires { output.write_async(*options.writer, filename); }) {
+    if (options.writer) {
+      output.write_async(*options.writer, filename);
+      return;
+    }
+  }
+  auto page = output.make_page(filename.c_str());
+  page.flush();
+}
+
+// kept in place of invalid values under Policy::CONTINUE: NULL if the
+// column is nullable, otherwise zero, the empty string or the epoch
+template <typename T>
+T invalid_value() {
+  if constexpr (types::IsNullable<T>::value) {
+    return T();
+  } else {
+    constexpr const char* literal = T::TAG == types::DATE ? "1970-01-01"
+                                  : T::TAG == types::TIMESTAMP ? "1970-01-01 00:00:00"
+                                  : T::TAG == types::CHAR || T::TAG == types::VARCHAR ? "" : "0";
+    return T::castString(literal, strlen(literal));
+  }
+}
+
 template <typename... Ts>
 struct TableImport {
 
@@ -76,24 +605,68 @@ struct TableImport {
 
   outputs_t outputs;
   io::MMapping<char> input;
+  ConvertOptions options;
+  // tests the raw value of the filter column
+  std::function<bool(const char*, uint32_t)> accept;
+  // tests the raw value of the sampling key
+  std::function<bool(const char*, uint32_t)> sample_key;
+  // malformed fields found by the last read
+  ingest::Report report;
+  // set if the read stopped at an error, nothing is written then
+  bool failed = false;
+  // one bit per column written by read_pipelined, TableReader skips them
+  uint64_t streamed = 0;
 
-  TableImport(const char *filename)
+  TableImport(const char *filename, const ConvertOptions& options = {})
       : outputs()
-      , input(filename) {}
+      , input(filename)
+      , options(options) {
+    if (options.hugepages) {
+      memory::advise_hugepages(input.data(), input.size());
+    }
+    init_filter();
+    init_sample();
+  }
 
-  TableImport(size_t size)
+  TableImport(size_t size, const ConvertOptions& options = {})
       : outputs()
-      , input(size) {}
+      , input(size)
+      , options(options) {
+    init_filter();
+    init_sample();
+  }
 
   ~TableImport() {}
 
   inline unsigned read() {
+    // projections, filters and validation are only implemented by the parallel reader
+    if (options.threads > 1 || options.projection != ~0ull || options.filtered() || options.sampled() || options.validate) {
+      return read_parallel(options.threads);
+    }
     std::vector<unsigned> columns(sizeof...(Ts));
     for (auto i = 0u; i != sizeof...(Ts); ++i) {
       columns[i] = i;
     }
 
+    // counting the lines first lets every column allocate its buffer once
+    size_t lines = std::count(input.data(), input.data() + input.size(), '\n');
+    if (input.size() && input.data()[input.size() - 1] != '\n') {
+      ++lines; // last line without newline
+    }
+    fold_outputs(0, [&](auto& output, unsigned, unsigned, unsigned) {
+      output.reserve(lines);
+      return 0;
+    });
+
+    auto progress = options.monitor ? &options.monitor->worker(0) : nullptr;
+    if (progress) {
+      progress->start();
+    }
+    uint64_t parsed = 0;
     unsigned rows = io::csv::read_file<delim>(input, columns, [&](unsigned col, CharIter& pos) {
+      if (progress && col == 0 && ++parsed % telemetry::PUBLISH_ROWS == 0) {
+        progress->publish(pos.iter - input.data(), parsed);
+      }
       fold_outputs(0, [&](auto& output, unsigned idx, unsigned num, unsigned v) {
         if (idx == col) {
           using value_t = typename std::remove_reference<decltype(output)>::type::value_t;
@@ -104,17 +677,647 @@ struct TableImport {
         return 0;
       });
     });
+    if (progress) {
+      progress->finish(input.size(), rows);
+    }
 
     return rows;
   }
   inline unsigned operator()() { return read(); }
 
+  /// Splits the input into one chunk of lines per worker, counts the rows of
+  /// each chunk and lets every worker parse its chunk straight into its part
+  /// of the columns. Workers are pinned round-robin to NUMA nodes and their
+  /// column ranges are placed on their node.
+  unsigned read_parallel(unsigned threads) {
+    auto& topology = memory::Topology::get();
+    char* begin = input.data();
+    char* end = begin + input.size();
+    std::vector<char*> bounds(threads + 1, end);
+    bounds[0] = begin;
+    for (auto w = 1u; w != threads; ++w) {
+      char* split = std::max(begin + input.size() * w / threads, bounds[w - 1]);
+      auto eol = static_cast<char*>(memchr(split, '\n', end - split));
+      bounds[w] = eol ? eol + 1 : end;
+    }
+
+    std::vector<size_t> first_row(threads + 1, 0);
+    run_workers(threads, [&](unsigned w) {
+      topology.pin_worker(w);
+      size_t rows = std::count(bounds[w], bounds[w + 1], '\n');
+      if (bounds[w + 1] == end && bounds[w] != end && end[-1] != '\n') {
+        ++rows; // last line without newline
+      }
+      first_row[w + 1] = rows;
+    });
+    for (auto w = 0u; w != threads; ++w) {
+      first_row[w + 1] += first_row[w];
+    }
+    auto rows = first_row[threads];
+    fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+      if (options.projected(idx)) {
+        output.resize(rows);
+      }
+      return 0;
+    });
+
+    std::array<std::atomic<uintptr_t>, sizeof...(Ts)> sizes{};
+    // rows that passed the filter, stored from first_row[w] on
+    std::vector<size_t> kept(threads);
+    std::vector<ingest::WorkerLog> logs(threads);
+    std::atomic<bool> stop = false;
+    run_workers(threads, [&](unsigned w) {
+      topology.pin_worker(w);
+      auto from = first_row[w], to = first_row[w + 1];
+      fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+        using value_t = typename std::remove_reference_t<decltype(output.items)>::value_type;
+        if (options.projected(idx)) {
+          topology.place(output.items.data() + from, (to - from) * sizeof(value_t), w);
+        }
+        return 0;
+      });
+      std::array<uintptr_t, sizeof...(Ts)> chunk_sizes{};
+      CharIter pos{bounds[w]};
+      auto out = from;
+      auto& log = logs[w];
+      auto progress = options.monitor ? &options.monitor->worker(w) : nullptr;
+      if (progress) {
+        progress->start();
+      }
+      for (auto row = from; row != to && !stop.load(std::memory_order_relaxed); ++row) {
+        if (progress && (row - from) % telemetry::PUBLISH_ROWS == 0) {
+          progress->publish(pos.iter - bounds[w], row - from);
+        }
+        if (selected(pos, row)) {
+          auto saved = chunk_sizes;
+          Field field{row + 1, log, stop};
+          if (parse_row(outputs, pos, out, chunk_sizes, field, std::index_sequence_for<Ts...>{})) {
+            ++out;
+          } else {
+            clear_row(outputs, out);
+            chunk_sizes = saved;
+            log.skipped_rows += options.errors == ingest::Policy::SKIP;
+          }
+        }
+        auto eol = static_cast<const char*>(memchr(pos.iter, '\n', end - pos.iter));
+        pos.iter += (eol ? eol + 1 : end) - pos.iter;
+      }
+      kept[w] = out - from;
+      if (progress) {
+        progress->finish(pos.iter - bounds[w], to - from);
+      }
+      for (auto i = 0u; i != sizeof...(Ts); ++i) {
+        sizes[i] += chunk_sizes[i];
+      }
+    });
+    report.merge(logs);
+    report.stopped = stop;
+    if (stop) {
+      failed = true;
+      return 0;
+    }
+    if (std::accumulate(kept.begin(), kept.end(), size_t(0)) != rows) {
+      rows = compact(first_row, kept);
+    }
+    fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+      output.output_size += sizes[idx];
+      return 0;
+    });
+    return rows;
+  }
+
+  /// How the pipeline writes a projected column, following write_column.
+  enum class Stream : uint8_t { SKIP, VALUES, INLINE, COLLECT };
+
+  template <typename T>
+  Stream stream_kind(unsigned idx) const {
+    if (!options.projected(idx)) {
+      return Stream::SKIP;
+    }
+    if constexpr (types::IsNullable<T>::value) {
+      // the validity file needs all rows
+      return Stream::COLLECT;
+    } else {
+      if constexpr (inline_string_column<T>) {
+        if (options.inline_strings) {
+          return Stream::INLINE;
+        }
+      }
+      if constexpr (narrow::narrowable<T>) {
+        if (options.narrow) {
+          return Stream::COLLECT;
+        }
+      }
+      if (options.bloomed(idx) || io::DataColumn<T>::size_tag::IS_VARIABLE) {
+        return Stream::COLLECT;
+      }
+      return Stream::VALUES;
+    }
+  }
+
+  /// One batch of input lines on its way through the pipeline.
+  struct Batch {
+    size_t seq;
+    const char* begin;
+    const char* end;
+    size_t first_line;
+    size_t lines;
+    outputs_t columns;
+    // rows kept and their contribution to output_size per column
+    size_t rows;
+    std::array<uintptr_t, sizeof...(Ts)> sizes;
+    // InlineString headers and long strings of INLINE columns
+    std::array<std::vector<types::InlineString>, sizeof...(Ts)> headers;
+    std::array<std::vector<char>, sizeof...(Ts)> heaps;
+    // position of the batch in the column files, assigned in input order
+    size_t row_base;
+    std::array<uint64_t, sizeof...(Ts)> heap_base;
+  };
+
+  /// Converts the table in batches through the stages of pipeline.hpp.
+  /// VALUES and INLINE columns are written to `files` while the input is
+  /// parsed and marked in `streamed`, the others are collected in `outputs`.
+  unsigned read_pipelined(const std::array<std::string, sizeof...(Ts)>& files) {
+    constexpr auto N = sizeof...(Ts);
+    const auto& stages = options.pipeline;
+    const auto parse_threads = stages.parse_threads(options.threads);
+    const auto batch_count = stages.batch_count(options.threads);
+
+    std::array<Stream, N> kinds;
+    std::array<std::optional<pipeline::StreamFile>, N> values, heaps;
+    fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+      kinds[idx] = stream_kind<typename std::remove_reference_t<decltype(output)>::value_t>(idx);
+      if (kinds[idx] == Stream::VALUES) {
+        values[idx].emplace(files[idx]);
+      } else if (kinds[idx] == Stream::INLINE) {
+        values[idx].emplace(column_sibling(files[idx], "inline"));
+        heaps[idx].emplace(column_sibling(files[idx], "heap"));
+      }
+      streamed |= static_cast<uint64_t>(values[idx].has_value()) << idx;
+      return 0;
+    });
+
+    std::vector<std::unique_ptr<Batch>> pool;
+    pipeline::Queue<Batch*> free_batches(batch_count), to_parse(batch_count + parse_threads),
+        to_encode(batch_count + stages.encode), to_write(batch_count + stages.write);
+    for (auto i = 0u; i != batch_count; ++i) {
+      pool.push_back(std::make_unique<Batch>());
+      free_batches.push(pool.back().get());
+    }
+    std::vector<ingest::WorkerLog> logs(parse_threads);
+    std::atomic<bool> stop = false;
+    std::atomic<int> write_error = 0;
+    std::atomic<unsigned> parsers_left = parse_threads, encoders_left = stages.encode;
+
+    // batches leave the encode stage in any order and enter the write stage in input order
+    std::mutex order_mutex;
+    std::vector<Batch*> waiting(batch_count, nullptr);
+    size_t next_seq = 0, total_rows = 0;
+    std::array<uint64_t, N> heap_total{};
+    auto sequence = [&](Batch* batch) {
+      std::lock_guard lock(order_mutex);
+      waiting[batch->seq % batch_count] = batch;
+      for (Batch* next; (next = waiting[next_seq % batch_count]); ++next_seq) {
+        waiting[next_seq % batch_count] = nullptr;
+        if (next_seq == 0 && next->end != next->begin) {
+          // extrapolate the row count from the first batch with some slack,
+          // reserved pages that are never written cost no memory
+          auto expected = next->lines * input.size() / (next->end - next->begin) * 5 / 4;
+          for_each_column(next->columns, [&](auto&, auto idx) {
+            if (kinds[idx] == Stream::COLLECT) {
+              std::get<decltype(idx)::value>(outputs).reserve(expected);
+            }
+          });
+        }
+        next->row_base = total_rows;
+        total_rows += next->rows;
+        for_each_column(next->columns, [&](auto& column, auto idx) {
+          if (kinds[idx] == Stream::INLINE) {
+            next->heap_base[idx] = heap_total[idx];
+            heap_total[idx] += next->heaps[idx].size();
+          } else if (kinds[idx] == Stream::COLLECT) {
+            std::get<decltype(idx)::value>(outputs).append_rows(column, next->rows, next->sizes[idx]);
+          }
+        });
+        to_write.push(next);
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() {
+      const char* pos = input.data();
+      const char* end = pos + input.size();
+      for (size_t seq = 0, line = 0; pos != end && !stop.load(std::memory_order_relaxed); ++seq) {
+        auto batch = free_batches.pop();
+        batch->seq = seq;
+        batch->begin = pos;
+        batch->first_line = line;
+        size_t lines = 0;
+        for (; lines != pipeline::BATCH_ROWS && pos != end; ++lines) {
+          auto eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+          pos = eol ? eol + 1 : end;
+        }
+        batch->end = pos;
+        batch->lines = lines;
+        line += lines;
+        to_parse.push(batch);
+      }
+      for (auto i = 0u; i != parse_threads; ++i) {
+        to_parse.push(nullptr);
+      }
+    });
+    for (auto w = 0u; w != parse_threads; ++w) {
+      threads.emplace_back([&, w]() {
+        auto progress = options.monitor ? &options.monitor->worker(w) : nullptr;
+        if (progress) {
+          progress->start();
+        }
+        uint64_t consumed = 0, parsed = 0;
+        while (auto batch = to_parse.pop()) {
+          parse_batch(*batch, logs[w], stop);
+          consumed += batch->end - batch->begin;
+          parsed += batch->lines;
+          if (progress) {
+            progress->publish(consumed, parsed);
+          }
+          to_encode.push(batch);
+        }
+        if (progress) {
+          progress->finish(consumed, parsed);
+        }
+        if (--parsers_left == 0) {
+          for (auto i = 0u; i != stages.encode; ++i) {
+            to_encode.push(nullptr);
+          }
+        }
+      });
+    }
+    for (auto e = 0u; e != stages.encode; ++e) {
+      threads.emplace_back([&]() {
+        while (auto batch = to_encode.pop()) {
+          encode_batch(*batch, kinds);
+          sequence(batch);
+        }
+        if (--encoders_left == 0) {
+          for (auto i = 0u; i != stages.write; ++i) {
+            to_write.push(nullptr);
+          }
+        }
+      });
+    }
+    for (auto w = 0u; w != stages.write; ++w) {
+      threads.emplace_back([&]() {
+        while (auto batch = to_write.pop()) {
+          if (auto error = write_batch(*batch, kinds, values, heaps)) {
+            int none = 0;
+            write_error.compare_exchange_strong(none, error);
+            stop = true;
+          }
+          // the input of the batch is not read again, its pages stay in the page cache
+          memory::release(batch->begin, batch->end - batch->begin);
+          free_batches.push(batch);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    report.merge(logs);
+    report.stopped = stop && !write_error;
+    auto finish = [&]() {
+      int error = write_error;
+      fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+        using value_t = typename std::remove_reference_t<decltype(output)>::value_t;
+        if (error || !values[idx]) {
+          return 0;
+        }
+        if (kinds[idx] == Stream::INLINE) {
+          using header_page_t = io::DataColumn<types::InlineString>;
+          using heap_page_t = io::DataColumn<char>;
+          auto header_size = header_page_t::GLOBAL_OVERHEAD + total_rows * sizeof(types::InlineString);
+          auto heap_size = heap_page_t::GLOBAL_OVERHEAD + heap_total[idx];
+          error = values[idx]->finish(column_header<header_page_t>(header_size), header_size);
+          error = error ? error : heaps[idx]->finish(column_header<heap_page_t>(heap_size), heap_size);
+        } else {
+          using page_t = io::DataColumn<value_t>;
+          auto size = page_t::GLOBAL_OVERHEAD + total_rows * sizeof(value_t);
+          error = values[idx]->finish(column_header<page_t>(size), size);
+        }
+        return 0;
+      });
+      return error;
+    };
+    if (auto error = stop ? write_error.load() : finish(); error || stop) {
+      if (error) {
+        std::cerr << "write error: " << strerror(error) << std::endl;
+      }
+      for (auto idx = 0u; idx != N; ++idx) {
+        if (values[idx]) {
+          values[idx]->discard();
+        }
+        if (heaps[idx]) {
+          heaps[idx]->discard();
+        }
+      }
+      failed = true;
+      return 0;
+    }
+    return total_rows;
+  }
+
+  /// Parses the lines of a batch like a read_parallel worker parses its chunk.
+  void parse_batch(Batch& batch, ingest::WorkerLog& log, std::atomic<bool>& stop) {
+    for_each_column(batch.columns, [&](auto& column, unsigned idx) {
+      if (options.projected(idx)) {
+        column.resize(batch.lines);
+      }
+    });
+    batch.sizes = {};
+    CharIter pos{batch.begin};
+    size_t out = 0;
+    for (size_t line = 0; line != batch.lines && !stop.load(std::memory_order_relaxed); ++line) {
+      auto row = batch.first_line + line;
+      if (selected(pos, row)) {
+        auto saved = batch.sizes;
+        Field field{row + 1, log, stop};
+        if (parse_row(batch.columns, pos, out, batch.sizes, field, std::index_sequence_for<Ts...>{})) {
+          ++out;
+        } else {
+          clear_row(batch.columns, out);
+          batch.sizes = saved;
+          log.skipped_rows += options.errors == ingest::Policy::SKIP;
+        }
+      }
+      auto eol = static_cast<const char*>(memchr(pos.iter, '\n', batch.end - pos.iter));
+      pos.iter += (eol ? eol + 1 : batch.end) - pos.iter;
+    }
+    batch.rows = stop ? 0 : out;
+    for_each_column(batch.columns, [&](auto& column, unsigned idx) {
+      if (options.projected(idx)) {
+        column.truncate(batch.rows);
+      }
+    });
+  }
+
+  /// Builds the InlineString headers of the batch, heap offsets are
+  /// relative to the batch until write_batch adds its heap_base.
+  void encode_batch(Batch& batch, const std::array<Stream, sizeof...(Ts)>& kinds) {
+    for_each_column(batch.columns, [&](auto& column, unsigned idx) {
+      using value_t = typename std::remove_reference_t<decltype(column)>::value_t;
+      if constexpr (inline_string_column<value_t>) {
+        if (kinds[idx] != Stream::INLINE) {
+          return;
+        }
+        auto& headers = batch.headers[idx];
+        auto& heap = batch.heaps[idx];
+        headers.resize(batch.rows);
+        heap.clear();
+        for (auto row = 0ul; row != batch.rows; ++row) {
+          auto& str = column.items[row];
+          headers[row] = types::InlineString::build(str.begin(), str.length(), heap.size());
+          if (str.length() > types::InlineString::INLINE_LEN) {
+            heap.insert(heap.end(), str.begin(), str.end());
+          }
+        }
+      }
+    });
+  }
+
+  /// Writes the streamed columns of a batch, returns 0 or an errno.
+  int write_batch(Batch& batch, const std::array<Stream, sizeof...(Ts)>& kinds,
+                  std::array<std::optional<pipeline::StreamFile>, sizeof...(Ts)>& values,
+                  std::array<std::optional<pipeline::StreamFile>, sizeof...(Ts)>& heaps) {
+    int error = 0;
+    for_each_column(batch.columns, [&](auto& column, unsigned idx) {
+      using value_t = typename std::remove_reference_t<decltype(column)>::value_t;
+      if (error || !batch.rows) {
+        return;
+      }
+      if (kinds[idx] == Stream::INLINE) {
+        using header_page_t = io::DataColumn<types::InlineString>;
+        using heap_page_t = io::DataColumn<char>;
+        auto& headers = batch.headers[idx];
+        for (auto& header : headers) {
+          if (!header.isInline()) {
+            header.offset += batch.heap_base[idx];
+          }
+        }
+        error = values[idx]->write(headers.data(), headers.size() * sizeof(types::InlineString),
+                                   header_page_t::GLOBAL_OVERHEAD + batch.row_base * sizeof(types::InlineString));
+        if (!error && !batch.heaps[idx].empty()) {
+          error = heaps[idx]->write(batch.heaps[idx].data(), batch.heaps[idx].size(),
+                                    heap_page_t::GLOBAL_OVERHEAD + batch.heap_base[idx]);
+        }
+      } else if (kinds[idx] == Stream::VALUES) {
+        using page_t = io::DataColumn<value_t>;
+        error = values[idx]->write(column.items.data(), batch.rows * sizeof(value_t),
+                                   page_t::GLOBAL_OVERHEAD + batch.row_base * sizeof(value_t));
+      }
+    });
+    return error;
+  }
+
+  /// Closes the gaps left by filtered rows at the end of every chunk.
+  size_t compact(const std::vector<size_t>& first_row, const std::vector<size_t>& kept) {
+    size_t rows = kept[0];
+    for (auto w = 1u; w < kept.size(); ++w) {
+      fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+        if (options.projected(idx)) {
+          output.move_rows(first_row[w], rows, kept[w]);
+        }
+        return 0;
+      });
+      rows += kept[w];
+    }
+    fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+      if (options.projected(idx)) {
+        output.truncate(rows);
+      }
+      return 0;
+    });
+    return rows;
+  }
+
+  /// Does the row at `pos` pass the filter and is it in the sample? Rows
+  /// that do not are skipped without parsing any other field.
+  inline bool selected(CharIter pos, size_t row) const {
+    if (accept && !test_field(pos, options.filter_column, accept)) {
+      return false;
+    }
+    if (!options.sampled()) {
+      return true;
+    }
+    if (sample_key) {
+      return test_field(pos, options.sample_column, sample_key);
+    }
+    return types::murmurHash64(row ^ options.sample_seed) < options.sample_threshold();
+  }
+
+  /// Evaluates fn on the raw value of `column` in the row at `pos`.
+  template <typename F>
+  static inline bool test_field(CharIter pos, int column, const F& fn) {
+    for (auto c = 0; c != column; ++c) {
+      io::csv::find_either<delim, '\n'>(pos);
+      ++pos.iter;
+    }
+    auto start = pos.iter;
+    io::csv::find_either<delim, '\n'>(pos);
+    return fn(start, pos.iter - start);
+  }
+
+  /// The row being parsed by a worker and where its errors go.
+  struct Field {
+    size_t line;
+    ingest::WorkerLog& log;
+    std::atomic<bool>& stop;
+    // set once a missing field has been reported for the row
+    bool truncated = false;
+  };
+
+  // parses into row `row` of `columns`, leaves pos on the terminator of the
+  // last field, false if the row is dropped
+  template <size_t... Is>
+  inline bool parse_row(outputs_t& columns, CharIter& pos, size_t row, std::array<uintptr_t, sizeof...(Ts)>& sizes,
+                        Field& field, std::index_sequence<Is...>) {
+    return (parse_field<Is, Ts>(columns, pos, row, sizes, field) && ...);
+  }
+
+  // columns outside the projection are only scanned for their delimiter;
+  // invalid values are reported and handled according to options.errors
+  template <size_t I, typename T>
+  inline bool parse_field(outputs_t& columns, CharIter& pos, size_t row, std::array<uintptr_t, sizeof...(Ts)>& sizes,
+                          Field& field) {
+    if constexpr (I != 0) {
+      if (*pos.iter != delim) [[unlikely]] {
+        // the line ended early, later columns are missing as well
+        if (!field.truncated) {
+          field.truncated = true;
+          if (!reject<I>(field, pos.iter, "missing fields")) {
+            return false;
+          }
+        }
+        if (options.projected(I)) {
+          sizes[I] += std::get<I>(columns).set(row, invalid_value<T>());
+        }
+        return true;
+      }
+      ++pos.iter;
+    }
+    if (!options.projected(I)) [[unlikely]] {
+      io::csv::find_either<delim, '\n'>(pos);
+      return true;
+    }
+    auto start = pos.iter;
+    T value;
+    if (auto error = io::csv::Parser<T>().template try_parse_value<delim>(pos, value)) [[unlikely]] {
+      if (!reject<I>(field, start, error)) {
+        return false;
+      }
+      value = invalid_value<T>();
+    }
+    sizes[I] += std::get<I>(columns).set(row, value);
+    return true;
+  }
+
+  // records an error, true if the row is kept with a NULL or zero value
+  template <size_t I>
+  inline bool reject(Field& field, const char* at, const char* reason) {
+    field.log.record(field.line, I, at - input.data(), reason);
+    switch (options.errors) {
+      case ingest::Policy::CONTINUE:
+        return true;
+      case ingest::Policy::STOP:
+        field.stop = true;
+        [[fallthrough]];
+      default:
+        return false;
+    }
+  }
+
+  // clears a dropped row in all columns
+  inline void clear_row(outputs_t& columns, size_t row) {
+    for_each_column(columns, [&](auto& column, unsigned idx) {
+      if (options.projected(idx)) {
+        column.clear_row(row);
+      }
+    });
+  }
+
+  template <typename F>
+  static inline void for_each_column(outputs_t& columns, const F& fn) {
+    [&]<size_t... Is>(std::index_sequence<Is...>) {
+      (fn(std::get<Is>(columns), std::integral_constant<unsigned, Is>{}), ...);
+    }(std::index_sequence_for<Ts...>{});
+  }
+
   inline constexpr static unsigned column_count() {
     return std::tuple_size_v<outputs_t>;
   }
 
   inline size_t row_count() {
-    return std::get<0>(outputs).items.size();
+    return fold_outputs(size_t(0), [](auto& output, unsigned, unsigned, size_t rows) {
+      return std::max(rows, output.items.size());
+    });
+  }
+
+  /// Keys are sampled by their hashKey, so key columns of the same type,
+  /// e.g. l_orderkey and o_orderkey, keep the same keys in every table.
+  void init_sample() {
+    if (!options.sampled() || options.sample_column < 0) {
+      return;
+    }
+    if (options.sample_column >= static_cast<int>(sizeof...(Ts))) {
+      throw "sample column out of range";
+    }
+    fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+      using value_t = typename std::remove_reference_t<decltype(output)>::value_t;
+      if (static_cast<int>(idx) == options.sample_column) {
+        sample_key = [seed = options.sample_seed, threshold = options.sample_threshold()](const char* str, uint32_t len) {
+          value_t value;
+          if (value_t::tryCastString(str, len, value)) {
+            return false;
+          }
+          return types::murmurHash64(types::hashKey(value) ^ seed) < threshold;
+        };
+      }
+      return 0;
+    });
+  }
+
+  void init_filter() {
+    if (!options.filtered()) {
+      return;
+    }
+    if (options.filter_column >= static_cast<int>(sizeof...(Ts))) {
+      throw "filter column out of range";
+    }
+    fold_outputs(0, [&](auto& output, unsigned idx, unsigned, unsigned) {
+      using value_t = typename std::remove_reference_t<decltype(output)>::value_t;
+      if (static_cast<int>(idx) != options.filter_column) {
+        return 0;
+      }
+      if constexpr (requires (const value_t& v) { v < v; }) {
+        std::optional<value_t> low, high;
+        if (!options.filter_low.empty()) {
+          low = value_t::castString(options.filter_low.data(), options.filter_low.size());
+        }
+        if (!options.filter_high.empty()) {
+          high = value_t::castString(options.filter_high.data(), options.filter_high.size());
+        }
+        // rows with a malformed value are dropped by the filter
+        accept = [low, high](const char* str, uint32_t len) {
+          value_t value;
+          if (value_t::tryCastString(str, len, value)) {
+            return false;
+          }
+          return (!low || !(value < *low)) && (!high || !(*high < value));
+        };
+      } else {
+        throw "filter column has no order";
+      }
+      return 0;
+    });
   }
 
   template <typename T, typename F, unsigned I = 0>
@@ -132,23 +1335,45 @@ struct TableReader : TableImport<Ts...> {
   using super_t = TableImport<Ts...>;
   std::array<std::string, sizeof...(Ts)> output_files;
 
-  TableReader(const std::string& output_prefix, const char* filename)
-    : super_t(filename) {
+  TableReader(const std::string& output_prefix, const char* filename, const ConvertOptions& options = {})
+    : super_t(filename, options) {
     // initialize output files
     std::filesystem::create_directories(output_prefix);
     this->fold_outputs(0, [&](const auto& output, unsigned idx, unsigned num, unsigned v) {
       using value_t = typename std::remove_reference<decltype(output)>::type::value_t;
-      using parser_t = io::csv::Parser<value_t>;
-      output_files[idx] = output_prefix + std::to_string(idx) + "." + parser_t::TYPE_NAME + ".bin";
+      output_files[idx] = column_file<value_t>(output_prefix, idx);
+      if constexpr (!requires { output.write_bloom(output_files[idx]); }) {
+        if (options.bloomed(idx)) {
+          throw "BLOOM needs an integer key column";
+        }
+      }
       return 0;
     });
   }
 
+  unsigned read() {
+    if (this->options.pipeline.enabled) {
+      return this->read_pipelined(output_files);
+    }
+    return super_t::read();
+  }
+
   ~TableReader() {
+    if (this->failed) {
+      return;
+    }
     // write to files
-    this->fold_outputs(0, [&](const auto& output, unsigned idx, unsigned num, unsigned v) {
-      auto page = output.make_page(output_files[idx].c_str());
-      page.flush();
+    this->fold_outputs(0, [&](auto& output, unsigned idx, unsigned num, unsigned v) {
+      if (!this->options.projected(idx) || (this->streamed >> idx) & 1) {
+        return 0;
+      }
+      // before write_column, the asynchronous writer takes the values
+      if constexpr (requires { output.write_bloom(output_files[idx]); }) {
+        if (this->options.bloomed(idx)) {
+          output.write_bloom(output_files[idx]);
+        }
+      }
+      write_column(output, output_files[idx], this->options);
       // for (auto item : page) {
       //   std::cout << "idx " << idx << " item " << item << std::endl;
       // }
@@ -156,3 +1381,307 @@ struct TableReader : TableImport<Ts...> {
     });
   }
 }; // struct TableReader
+
+template<typename T>
+struct ColumnInput {
+  using value_t = T;
+  using page_t = io::DataColumn<T>;
+
+  page_t page;
+
+  ColumnInput(const char* filename) : page(filename) {}
+
+  inline size_t size() const {
+    if constexpr (page_t::size_tag::IS_VARIABLE) {
+      return page.data()->count;
+    } else {
+      return page.size();
+    }
+  }
+
+  inline decltype(auto) operator[](size_t idx) const {
+    if constexpr (page_t::size_tag::IS_VARIABLE) {
+      auto& slot = const_cast<page_t&>(page).slot_at(idx);
+      return std::string_view(reinterpret_cast<const char*>(page.data()) + slot.offset, slot.size);
+    } else {
+      return static_cast<const T&>(page.begin()[idx]);
+    }
+  }
+};
+
+/// Reads a string column written in the InlineString layout.
+struct InlineStringInput {
+  using header_page_t = io::DataColumn<types::InlineString>;
+  using heap_page_t = io::DataColumn<char>;
+
+  header_page_t headers;
+  heap_page_t heap;
+
+  InlineStringInput(const std::string& column_file)
+    : headers(column_sibling(column_file, "inline").c_str())
+    , heap(column_sibling(column_file, "heap").c_str()) {}
+
+  inline size_t size() const { return headers.size(); }
+  inline const types::InlineString& operator[](size_t idx) const { return headers.begin()[idx]; }
+  inline const char* heap_data() const { return heap.begin(); }
+  inline std::string_view view(size_t idx) const {
+    auto& str = (*this)[idx];
+    return std::string_view(str.begin(heap_data()), str.length());
+  }
+};
+
+/// Reads a column written with NARROW=1 and widens its values on access.
+template <narrow::narrowable T>
+struct NarrowColumnInput {
+  using page_t = io::DataColumn<uint64_t>;
+
+  page_t page;
+  size_t rows;
+  size_t blocks;
+  const uint64_t* directory;
+  const uint64_t* data;
+
+  NarrowColumnInput(const std::string& column_file) : page(column_sibling(column_file, "narrow").c_str()) {
+    rows = page.begin()[0];
+    blocks = page.begin()[2];
+    directory = page.begin() + narrow::HEADER_WORDS;
+    data = directory + blocks * narrow::DIRECTORY_WORDS;
+  }
+
+  inline size_t size() const { return rows; }
+  inline int64_t base(size_t block) const { return static_cast<int64_t>(directory[block * narrow::DIRECTORY_WORDS]); }
+  inline unsigned width(size_t block) const { return directory[block * narrow::DIRECTORY_WORDS + 1] & 0xff; }
+  inline const void* block_data(size_t block) const { return data + (directory[block * narrow::DIRECTORY_WORDS + 1] >> 8); }
+
+  /// Upper bound of the values of a block, implied by its width.
+  inline int64_t max_bound(size_t block) const {
+    auto w = width(block);
+    uint64_t range = w >= 8 ? std::numeric_limits<uint64_t>::max() : (1ull << (8 * w)) - 1;
+    auto room = static_cast<uint64_t>(std::numeric_limits<int64_t>::max() - base(block));
+    return base(block) + static_cast<int64_t>(std::min(range, room));
+  }
+
+  inline T operator[](size_t row) const {
+    auto block = row / narrow::BLOCK_ROWS, idx = row % narrow::BLOCK_ROWS;
+    auto in = block_data(block);
+    uint64_t offset;
+    switch (width(block)) {
+      case 1: offset = static_cast<const uint8_t*>(in)[idx]; break;
+      case 2: offset = static_cast<const uint16_t*>(in)[idx]; break;
+      case 4: offset = static_cast<const uint32_t*>(in)[idx]; break;
+      default: offset = static_cast<const uint64_t*>(in)[idx]; break;
+    }
+    return T(static_cast<narrow::raw_t<T>>(base(block) + static_cast<int64_t>(offset)));
+  }
+
+  /// Widens all values of a block into `out`, returns their number. Scans
+  /// should use this rather than operator[].
+  size_t decode_block(size_t block, T* out) const {
+    auto count = std::min<size_t>(narrow::BLOCK_ROWS, rows - block * narrow::BLOCK_ROWS);
+    switch (width(block)) {
+      case 1: narrow::unpack<uint8_t>(block_data(block), count, base(block), out); break;
+      case 2: narrow::unpack<uint16_t>(block_data(block), count, base(block), out); break;
+      case 4: narrow::unpack<uint32_t>(block_data(block), count, base(block), out); break;
+      default: narrow::unpack<uint64_t>(block_data(block), count, base(block), out); break;
+    }
+    return count;
+  }
+
+  /// Bytes read by a scan, compared to page_t::GLOBAL_OVERHEAD + rows * sizeof(T) unnarrowed.
+  inline size_t stored_size() const { return page.file_size; }
+};
+
+/// Reads the Bloom filters written for a key column with BLOOM. Probes
+/// hash the keys with bloom::key_hash once and test them against the
+/// blocks, e.g. to skip the blocks of l_orderkey without a given order:
+///
+///   BloomFilterInput<Integer> filters(column_file);
+///   auto hash = bloom::key_hash(orderkey);
+///   for (size_t block = 0; block != filters.blocks; ++block)
+///     if (filters.may_contain(block, hash)) ...
+template <bloom::key_column T>
+struct BloomFilterInput {
+  using page_t = io::DataColumn<uint64_t>;
+
+  page_t page;
+  size_t rows;
+  size_t blocks;
+  const uint64_t* directory;
+  const uint64_t* data;
+
+  BloomFilterInput(const std::string& column_file) : page(column_sibling(column_file, "bloom").c_str()) {
+    rows = page.begin()[0];
+    blocks = page.begin()[2];
+    directory = page.begin() + bloom::HEADER_WORDS;
+    data = directory + blocks * bloom::DIRECTORY_WORDS;
+  }
+
+  inline size_t size() const { return rows; }
+  inline size_t block_rows() const { return bloom::BLOCK_ROWS; }
+
+  inline bloom::Filter filter(size_t block) const {
+    return {data + directory[block * bloom::DIRECTORY_WORDS], directory[block * bloom::DIRECTORY_WORDS + 1]};
+  }
+
+  inline bool may_contain(size_t block, uint64_t hash) const { return filter(block).may_contain(hash); }
+  inline bool may_contain(size_t block, const T& key) const { return may_contain(block, bloom::key_hash(key)); }
+
+  /// Marks the blocks that may contain any of the hashed keys, returns their number.
+  size_t select_blocks(const uint64_t* hashes, size_t count, std::vector<bool>& selected) const {
+    selected.assign(blocks, false);
+    size_t result = 0;
+    for (auto block = 0ul; block != blocks; ++block) {
+      selected[block] = filter(block).may_contain_any(hashes, count);
+      result += selected[block];
+    }
+    return result;
+  }
+};
+
+/// Reads the validity file of a nullable column, all rows are valid if
+/// there is none.
+template <typename T>
+struct ValidityInput {
+  using output_t = ColumnOutput<types::Nullable<T>>;
+  using validity_page_t = typename output_t::validity_page_t;
+
+  std::optional<validity_page_t> validity;
+  const uint64_t* directory = nullptr;
+  const uint64_t* bitmaps = nullptr;
+
+  ValidityInput(const std::string& column_file) : validity() {
+    auto valid_file = column_sibling(column_file, "valid");
+    if (std::filesystem::exists(valid_file)) {
+      validity.emplace(valid_file.c_str());
+      directory = validity->begin() + output_t::HEADER_WORDS;
+      bitmaps = directory + validity->begin()[2];
+    }
+  }
+
+  /// Does the block starting at `row` contain no NULLs?
+  inline bool all_valid(size_t row) const {
+    return !directory || directory[row / output_t::BLOCK_ROWS] == output_t::ALL_VALID;
+  }
+
+  inline bool is_null(size_t row) const {
+    if (all_valid(row)) {
+      return false;
+    }
+    auto bitmap = bitmaps + directory[row / output_t::BLOCK_ROWS] * output_t::BLOCK_WORDS;
+    auto in_block = row % output_t::BLOCK_ROWS;
+    return !((bitmap[in_block / 64] >> (in_block % 64)) & 1);
+  }
+};
+
+/// Reads a nullable column and its validity file, if there is one.
+template<typename T>
+struct ColumnInput<types::Nullable<T>> : ColumnInput<T>, ValidityInput<T> {
+  using value_t = types::Nullable<T>;
+
+  ColumnInput(const char* filename) : ColumnInput<T>(filename), ValidityInput<T>(filename) {}
+
+  inline value_t operator[](size_t idx) const {
+    if (this->is_null(idx)) {
+      return value_t::makeNull();
+    }
+    return value_t(ColumnInput<T>::operator[](idx));
+  }
+};
+
+/// Writes the binary columns of a table back into the `|`-delimited .tbl
+/// format. Rows are formatted in morsels by all workers in parallel and
+/// appended to the output file in row order.
+template <typename... Ts>
+struct TableExport {
+  static constexpr size_t MORSEL_ROWS = 64 * 1024;
+  // widest possible row: all values, one delimiter per value, newline
+  static constexpr size_t MAX_ROW_WIDTH = (io::csv::Formatter<Ts>::MAX_WIDTH + ...) + sizeof...(Ts) + 1;
+
+  using inputs_t = std::tuple<ColumnInput<Ts>...>;
+
+  inputs_t inputs;
+  /// decimal columns printed without fraction if it is zero
+  std::array<bool, sizeof...(Ts)> integral{};
+
+  TableExport(const std::string& input_prefix)
+    : inputs(open_inputs(input_prefix, std::index_sequence_for<Ts...>{})) {}
+
+  inline size_t row_count() const {
+    return std::get<0>(inputs).size();
+  }
+
+  size_t write(const char* filename, unsigned threads) {
+    auto fd = ::open(filename, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) {
+      throw "could not open export output file";
+    }
+    auto rows = row_count();
+    auto morsels = (rows + MORSEL_ROWS - 1) / MORSEL_ROWS;
+    std::atomic<size_t> next_morsel = 0;
+    std::atomic<size_t> written_bytes = 0;
+    // morsels are claimed in order, so waiting for predecessors is short
+    size_t next_write = 0;
+    std::mutex write_mutex;
+    std::condition_variable write_cv;
+    // errno of the first failed write, later morsels are then dropped
+    int write_error = 0;
+
+    run_workers(threads, [&](unsigned) {
+      std::vector<char> buffer(MORSEL_ROWS * MAX_ROW_WIDTH);
+      for (auto morsel = next_morsel++; morsel < morsels; morsel = next_morsel++) {
+        auto begin = morsel * MORSEL_ROWS, end = std::min(rows, begin + MORSEL_ROWS);
+        char* out = buffer.data();
+        for (auto row = begin; row != end; ++row) {
+          out = format_row(out, row, std::index_sequence_for<Ts...>{});
+        }
+        size_t size = out - buffer.data();
+        std::unique_lock lock(write_mutex);
+        write_cv.wait(lock, [&]() { return next_write == morsel; });
+        for (size_t done = 0; done != size && !write_error;) {
+          auto res = ::write(fd, buffer.data() + done, size - done);
+          if (res < 0 && errno == EINTR) {
+            continue;
+          }
+          if (res <= 0) {
+            write_error = res < 0 ? errno : EIO;
+            break;
+          }
+          done += res;
+        }
+        written_bytes += write_error ? 0 : size;
+        ++next_write;
+        write_cv.notify_all();
+      }
+    });
+    ::close(fd);
+    if (write_error) {
+      std::cerr << filename << ": " << strerror(write_error) << std::endl;
+      throw "could not write export output file";
+    }
+    return written_bytes;
+  }
+
+private:
+  template <size_t... Is>
+  static inputs_t open_inputs(const std::string& prefix, std::index_sequence<Is...>) {
+    return inputs_t(column_file<Ts>(prefix, Is).c_str()...);
+  }
+
+  template <size_t I, typename T>
+  inline char* format_value(char* out, size_t row) const {
+    using formatter_t = io::csv::Formatter<T>;
+    if constexpr (requires { formatter_t::format_integral; }) {
+      if (integral[I]) {
+        return formatter_t::format_integral(out, std::get<I>(inputs)[row]);
+      }
+    }
+    return formatter_t::format(out, std::get<I>(inputs)[row]);
+  }
+
+  template <size_t... Is>
+  inline char* format_row(char* out, size_t row, std::index_sequence<Is...>) const {
+    ((out = format_value<Is, Ts>(out, row), *out++ = delim), ...);
+    *out++ = '\n';
+    return out;
+  }
+}; // struct TableExport
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "csv-read/util.hpp"
+
+/// Single-file tables. With CONTAINER=1 the column files of a converted
+/// table are packed into <table>/table.bin, so a reader maps one file per
+/// table instead of one per column and auxiliary file:
+///
+///   section 0 | pad | section 1 | pad | ... | footer | trailer
+///
+/// Every section is a byte copy of one column file, including its
+/// io::DataColumn header, and starts on a page boundary, so its values are
+/// aligned exactly as in a freshly mapped column file. The footer is text,
+/// one line per section:
+///
+///   container <version>
+///   rows <rows>
+///   section <column> <name> <type> <kind> <offset> <size> <rows>
+///
+/// with the column names of tpch::*_c and the kind of the file: values for
+/// <idx>.<type>.bin, otherwise its suffix (inline, heap, narrow, valid,
+/// bloom). The trailer is the footer offset, the footer size and MAGIC.
+/// CONTAINER=only removes the column files after packing them; the other
+/// tools read the column files, so only container::Table can read such a
+/// table.
+namespace container {
+
+    static constexpr unsigned VERSION = 1;
+    static constexpr const char* FILE_NAME = "table.bin";
+    static constexpr uint64_t ALIGNMENT = 4096;
+    static constexpr uint64_t TRAILER_WORDS = 3;
+    static constexpr uint64_t MAGIC = 0x3142545848435054ull; // "TPCHXTB1"
+
+    enum class Mode { OFF, WITH_COLUMNS, ONLY };
+
+    inline Mode parse_mode(std::string_view spec) {
+        if (spec == "only") {
+            return Mode::ONLY;
+        }
+        return spec.empty() || spec == "0" ? Mode::OFF : Mode::WITH_COLUMNS;
+    }
+
+    struct Section {
+        unsigned column;
+        std::string name;
+        std::string type;
+        std::string kind;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t rows;
+    };
+
+    /// Splits <idx>.<type>[.<kind>].bin, false for other files.
+    inline bool parse_file_name(std::string_view file, Section& section) {
+        if (file.size() < 4 || file.substr(file.size() - 4) != ".bin") {
+            return false;
+        }
+        file.remove_suffix(4);
+        auto dot = file.find('.');
+        if (dot == 0 || dot == std::string_view::npos
+            || !std::all_of(file.begin(), file.begin() + dot, [](char c) { return c >= '0' && c <= '9'; })) {
+            return false;
+        }
+        section.column = std::stoul(std::string(file.substr(0, dot)));
+        file.remove_prefix(dot + 1);
+        dot = file.find('.');
+        section.type = file.substr(0, dot);
+        section.kind = dot == std::string_view::npos ? "values" : file.substr(dot + 1);
+        return !section.type.empty() && !section.kind.empty();
+    }
+
+    /// Copies `bytes` from `in` to `out` at `offset` without passing them
+    /// through user space where the file system allows it.
+    inline void copy_file(int in, int out, uint64_t bytes, uint64_t offset) {
+        loff_t in_offset = 0, out_offset = offset;
+        while (bytes) {
+            auto done = copy_file_range(in, &in_offset, out, &out_offset, bytes, 0);
+            if (done > 0) {
+                bytes -= done;
+                continue;
+            }
+            if (done < 0 && errno == EINTR) {
+                continue;
+            }
+            if (done == 0 || (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP)) {
+                throw "cannot copy column file into container";
+            }
+            std::vector<char> buffer(1 << 20);
+            while (bytes) {
+                auto got = pread(in, buffer.data(), std::min<uint64_t>(bytes, buffer.size()), in_offset);
+                if (got <= 0) {
+                    throw "cannot read column file";
+                }
+                for (ssize_t put = 0; put != got;) {
+                    auto res = pwrite(out, buffer.data() + put, got - put, out_offset + put);
+                    if (res < 0) {
+                        throw "cannot write container";
+                    }
+                    put += res;
+                }
+                in_offset += got;
+                out_offset += got;
+                bytes -= got;
+            }
+        }
+    }
+
+    /// Packs the column files in `dir` into dir + FILE_NAME, `names` are the
+    /// column names by index. Removes the column files if `keep_columns` is
+    /// false. Returns the container size.
+    inline uint64_t pack(const std::string& dir, uint64_t rows, std::span<const char* const> names, bool keep_columns = true) {
+        std::vector<Section> sections;
+        for (auto& entry : std::filesystem::directory_iterator(dir)) {
+            Section section;
+            if (entry.is_regular_file() && parse_file_name(entry.path().filename().string(), section)) {
+                if (section.column >= names.size()) {
+                    throw "column file without a column name";
+                }
+                section.name = names[section.column];
+                section.size = entry.file_size();
+                section.rows = rows;
+                sections.push_back(std::move(section));
+            }
+        }
+        std::sort(sections.begin(), sections.end(), [](const Section& a, const Section& b) {
+            return a.column != b.column ? a.column < b.column : a.kind < b.kind;
+        });
+        auto file_of = [&](const Section& s) {
+            return dir + std::to_string(s.column) + "." + s.type + (s.kind == "values" ? "" : "." + s.kind) + ".bin";
+        };
+
+        // written under a temporary name, a crash never leaves a partial container
+        auto path = dir + FILE_NAME, partial = path + ".partial";
+        int out = ::open(partial.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+        if (out < 0) {
+            throw "cannot create container";
+        }
+        std::ostringstream footer;
+        footer << "container " << VERSION << "\nrows " << rows << "\n";
+        uint64_t offset = 0;
+        try {
+            for (auto& section : sections) {
+                section.offset = offset = (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+                int in = ::open(file_of(section).c_str(), O_RDONLY | O_CLOEXEC);
+                if (in < 0) {
+                    throw "cannot open column file";
+                }
+                try {
+                    copy_file(in, out, section.size, offset);
+                } catch (...) {
+                    close(in);
+                    throw;
+                }
+                close(in);
+                offset += section.size;
+                footer << "section " << section.column << " " << section.name << " " << section.type << " " << section.kind
+                       << " " << section.offset << " " << section.size << " " << section.rows << "\n";
+            }
+            auto text = footer.str();
+            uint64_t trailer[TRAILER_WORDS] = {offset, text.size(), MAGIC};
+            text.append(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+            for (size_t done = 0; done != text.size();) {
+                auto res = pwrite(out, text.data() + done, text.size() - done, offset + done);
+                if (res < 0) {
+                    throw "cannot write container";
+                }
+                done += res;
+            }
+            offset += text.size();
+        } catch (...) {
+            close(out);
+            std::filesystem::remove(partial);
+            throw;
+        }
+        close(out);
+        std::filesystem::rename(partial, path);
+        if (!keep_columns) {
+            for (auto& section : sections) {
+                std::filesystem::remove(file_of(section));
+            }
+        }
+        return offset;
+    }
+
+    /// A packed table, mapped once. Sections are looked up by column name or
+    /// index and kind; fixed-size payloads are typed directly:
+    ///
+    ///   container::Table orders("out/orders/");
+    ///   auto keys = orders.values<types::Integer>("o_orderkey");
+    ///   auto words = orders.values<uint64_t>(l_shipdate, "narrow");
+    class Table {
+        io::MMapping<char> file;
+        std::vector<Section> sections;
+        uint64_t row_count = 0;
+
+    public:
+        explicit Table(const std::string& dir) : file((dir + FILE_NAME).c_str()) {
+            auto size = file.size();
+            uint64_t trailer[TRAILER_WORDS];
+            if (size < sizeof(trailer)) {
+                throw "container too small";
+            }
+            memcpy(trailer, file.data() + size - sizeof(trailer), sizeof(trailer));
+            if (trailer[2] != MAGIC || trailer[0] + trailer[1] + sizeof(trailer) != size) {
+                throw "not a table container";
+            }
+            std::istringstream footer(std::string(file.data() + trailer[0], trailer[1]));
+            std::string key;
+            unsigned version = 0;
+            footer >> key >> version;
+            if (key != "container" || version != VERSION) {
+                throw "unsupported container version";
+            }
+            footer >> key >> row_count;
+            Section section;
+            while (footer >> key >> section.column >> section.name >> section.type >> section.kind
+                   >> section.offset >> section.size >> section.rows) {
+                if (section.offset + section.size > trailer[0]) {
+                    throw "container section out of bounds";
+                }
+                sections.push_back(section);
+            }
+        }
+
+        inline uint64_t rows() const { return row_count; }
+        inline const std::vector<Section>& all() const { return sections; }
+
+        /// nullptr if the table has no such section.
+        const Section* find(unsigned column, std::string_view kind = "values") const {
+            for (auto& section : sections) {
+                if (section.column == column && section.kind == kind) {
+                    return &section;
+                }
+            }
+            return nullptr;
+        }
+        const Section* find(std::string_view name, std::string_view kind = "values") const {
+            for (auto& section : sections) {
+                if (section.name == name && section.kind == kind) {
+                    return &section;
+                }
+            }
+            return nullptr;
+        }
+
+        /// The bytes of the column file stored in `section`.
+        inline std::span<const char> bytes(const Section& section) const {
+            return {file.data() + section.offset, section.size};
+        }
+
+        /// The values after the io::DataColumn header of a fixed-size section.
+        template <typename T, typename Column>
+        std::span<const T> values(const Column& column, std::string_view kind = "values") const {
+            using page_t = io::DataColumn<T>;
+            static_assert(!page_t::size_tag::IS_VARIABLE, "variable-size columns are read through bytes()");
+            auto section = find(column, kind);
+            if (!section) {
+                throw "column not in container";
+            }
+            auto data = bytes(*section);
+            return {reinterpret_cast<const T*>(data.data() + page_t::GLOBAL_OVERHEAD), (data.size() - page_t::GLOBAL_OVERHEAD) / sizeof(T)};
+        }
+
+        /// Asks the kernel to read a section ahead, e.g. before a scan over a
+        /// network file system.
+        void prefetch(const Section& section) const {
+            auto begin = reinterpret_cast<uintptr_t>(file.data() + section.offset) & ~(ALIGNMENT - 1);
+            auto end = reinterpret_cast<uintptr_t>(file.data() + section.offset + section.size);
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+        }
+    };
+
+} // namespace container
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "types.hpp"
+
+/// Block-at-a-time fixed-point arithmetic on Numeric values. Expressions
+/// over column blocks and constants are built with +, - and * and evaluated
+/// in one pass, four 64-bit lanes at a time with AVX2:
+///
+///   using namespace decimal;
+///   auto disc_price = column(&price[begin]) * (constant(ONE) - column(&discount[begin]));
+///   evaluate(disc_price, out, n);
+///   auto revenue = sum(disc_price, n);
+///
+/// Results are scaled like the Numeric operators, a product of precisions p
+/// and q has precision p + q. Every expression carries a bound on its
+/// decimal digits, derived at compile time from the Numeric lengths. Where
+/// the bound fits 64 bits the lanes are computed unchecked. Products of
+/// factors of up to 9 digits use one 32x32 multiply per lane. Otherwise
+/// every four lanes are checked at runtime and fall back to overflow-checked
+/// scalar arithmetic, which throws.
+namespace decimal {
+
+    using types::Numeric;
+
+    // decimal digits that always fit into an int64_t
+    static constexpr unsigned SAFE_DIGITS = 18;
+    // decimal digits that always fit into an int32_t
+    static constexpr unsigned SAFE_DIGITS_32 = 9;
+
+    inline int64_t checked_mul(int64_t a, int64_t b) {
+        int64_t result;
+        if (__builtin_mul_overflow(a, b, &result)) {
+            throw "numeric overflow";
+        }
+        return result;
+    }
+
+    inline int64_t checked_add(int64_t a, int64_t b) {
+        int64_t result;
+        if (__builtin_add_overflow(a, b, &result)) {
+            throw "numeric overflow";
+        }
+        return result;
+    }
+
+    inline int64_t checked_sub(int64_t a, int64_t b) {
+        int64_t result;
+        if (__builtin_sub_overflow(a, b, &result)) {
+            throw "numeric overflow";
+        }
+        return result;
+    }
+
+#ifdef __AVX2__
+    /// Low 64 bits of the lane products, AVX2 only multiplies 32-bit halves.
+    inline __m256i mul_lo64(__m256i a, __m256i b) {
+        __m256i lo = _mm256_mul_epu32(a, b);
+        __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+        return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+    }
+
+    /// Do all lanes of a and b fit into an int32_t?
+    inline bool fit_int32(__m256i a, __m256i b) {
+        const __m256i bias = _mm256_set1_epi64x(int64_t(1) << 31);
+        __m256i high = _mm256_srli_epi64(_mm256_or_si256(_mm256_add_epi64(a, bias), _mm256_add_epi64(b, bias)), 32);
+        return _mm256_testz_si256(high, high);
+    }
+#endif
+
+    /// Expression nodes have a Numeric `type`, a bound on their `DIGITS`,
+    /// at(i) computing row i with overflow checks where needed and, with
+    /// AVX2, load(i, lanes) computing rows i to i + 3 or returning false
+    /// when the rows need the checked path.
+    template <typename E>
+    concept expression = requires(const E& e, size_t i) {
+        typename E::type;
+        { E::DIGITS } -> std::convertible_to<unsigned>;
+        { e.at(i) } -> std::same_as<int64_t>;
+    };
+
+    /// A block of a Numeric column.
+    template <typename N>
+    struct Column {
+        using type = N;
+        static constexpr unsigned DIGITS = N::LENGTH;
+        static_assert(sizeof(N) == sizeof(int64_t));
+        const N* values;
+
+        inline int64_t at(size_t i) const { return values[i].value; }
+#ifdef __AVX2__
+        inline bool load(size_t i, __m256i& lanes) const {
+            lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            return true;
+        }
+#endif
+    };
+
+    /// A constant operand, e.g. the 1 in 1 - l_discount.
+    template <typename N>
+    struct Constant {
+        using type = N;
+        static constexpr unsigned DIGITS = N::LENGTH;
+        int64_t value;
+
+        inline int64_t at(size_t) const { return value; }
+#ifdef __AVX2__
+        inline bool load(size_t, __m256i& lanes) const {
+            lanes = _mm256_set1_epi64x(value);
+            return true;
+        }
+#endif
+    };
+
+    template <typename N>
+    inline Column<N> column(const N* values) { return {values}; }
+    template <typename N>
+    inline Constant<N> constant(N value) { return {value.value}; }
+
+    template <expression A, expression B, bool subtract>
+    struct AddSub {
+        static_assert(std::is_same_v<typename A::type, typename B::type>, "operands must have the same scale");
+        using type = typename A::type;
+        static constexpr unsigned DIGITS = std::max(A::DIGITS, B::DIGITS) + 1;
+        static constexpr bool SAFE = DIGITS <= SAFE_DIGITS;
+        A a;
+        B b;
+
+        inline int64_t at(size_t i) const {
+            if constexpr (SAFE) {
+                return subtract ? a.at(i) - b.at(i) : a.at(i) + b.at(i);
+            } else {
+                return subtract ? checked_sub(a.at(i), b.at(i)) : checked_add(a.at(i), b.at(i));
+            }
+        }
+#ifdef __AVX2__
+        inline bool load(size_t i, __m256i& lanes) const {
+            __m256i x, y;
+            if (!SAFE || !a.load(i, x) || !b.load(i, y)) {
+                return false;
+            }
+            lanes = subtract ? _mm256_sub_epi64(x, y) : _mm256_add_epi64(x, y);
+            return true;
+        }
+#endif
+    };
+
+    template <expression A, expression B>
+    struct Mul {
+        using type = Numeric<A::type::LENGTH, A::type::PRECISION + B::type::PRECISION>;
+        static constexpr unsigned DIGITS = A::DIGITS + B::DIGITS;
+        static constexpr bool NARROW = A::DIGITS <= SAFE_DIGITS_32 && B::DIGITS <= SAFE_DIGITS_32;
+        static constexpr bool SAFE = DIGITS <= SAFE_DIGITS;
+        A a;
+        B b;
+
+        inline int64_t at(size_t i) const {
+            return SAFE ? a.at(i) * b.at(i) : checked_mul(a.at(i), b.at(i));
+        }
+#ifdef __AVX2__
+        inline bool load(size_t i, __m256i& lanes) const {
+            __m256i x, y;
+            if (!a.load(i, x) || !b.load(i, y)) {
+                return false;
+            }
+            if constexpr (NARROW) {
+                lanes = _mm256_mul_epi32(x, y);
+            } else if constexpr (SAFE) {
+                lanes = mul_lo64(x, y);
+            } else if (fit_int32(x, y)) {
+                lanes = _mm256_mul_epi32(x, y);
+            } else {
+                return false;
+            }
+            return true;
+        }
+#endif
+    };
+
+    /// Multiplies by 10^shift, like castP1 and castP2.
+    template <unsigned shift, expression A>
+    struct Scale {
+        static_assert(shift <= SAFE_DIGITS);
+        using type = Numeric<A::type::LENGTH, A::type::PRECISION + shift>;
+        static constexpr unsigned DIGITS = A::DIGITS + shift;
+        static constexpr bool SAFE = DIGITS <= SAFE_DIGITS;
+        static constexpr int64_t FACTOR = types::numericShifts[shift];
+        A a;
+
+        inline int64_t at(size_t i) const {
+            return SAFE ? a.at(i) * FACTOR : checked_mul(a.at(i), FACTOR);
+        }
+#ifdef __AVX2__
+        inline bool load(size_t i, __m256i& lanes) const {
+            __m256i x;
+            if (!SAFE || !a.load(i, x)) {
+                return false;
+            }
+            lanes = mul_lo64(x, _mm256_set1_epi64x(FACTOR));
+            return true;
+        }
+#endif
+    };
+
+    template <expression A, expression B>
+    inline AddSub<A, B, false> operator+(A a, B b) { return {a, b}; }
+    template <expression A, expression B>
+    inline AddSub<A, B, true> operator-(A a, B b) { return {a, b}; }
+    template <expression A, expression B>
+    inline Mul<A, B> operator*(A a, B b) { return {a, b}; }
+    template <unsigned shift, expression A>
+    inline Scale<shift, A> scale(A a) { return {a}; }
+
+    /// out[i] = e(i) for i < count.
+    template <expression E>
+    void evaluate(const E& e, typename E::type* out, size_t count) {
+        size_t i = 0;
+#ifdef __AVX2__
+        for (; i + 4 <= count; i += 4) {
+            __m256i lanes;
+            if (e.load(i, lanes)) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), lanes);
+            } else {
+                for (auto j = i; j != i + 4; ++j) {
+                    out[j].value = e.at(j);
+                }
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i].value = e.at(i);
+        }
+    }
+
+    /// Sum of e(i) for i < count, in 64-bit lanes when count values of the
+    /// expression's digits cannot overflow.
+    template <expression E>
+    typename E::type sum(const E& e, size_t count) {
+        int64_t result = 0;
+        size_t i = 0;
+        if (E::DIGITS < SAFE_DIGITS && count <= types::numericShifts[SAFE_DIGITS - std::min(E::DIGITS, SAFE_DIGITS)]) {
+#ifdef __AVX2__
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 4 <= count; i += 4) {
+                __m256i lanes;
+                if (e.load(i, lanes)) {
+                    acc = _mm256_add_epi64(acc, lanes);
+                } else {
+                    for (auto j = i; j != i + 4; ++j) {
+                        result += e.at(j);
+                    }
+                }
+            }
+            alignas(32) int64_t partial[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(partial), acc);
+            result += partial[0] + partial[1] + partial[2] + partial[3];
+#endif
+            for (; i < count; ++i) {
+                result += e.at(i);
+            }
+        } else {
+            for (; i < count; ++i) {
+                result = checked_add(result, e.at(i));
+            }
+        }
+        return typename E::type(result);
+    }
+
+} // namespace decimal
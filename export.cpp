@@ -0,0 +1,41 @@
+#include "csv-read/csv.hpp"
+#include "common.hpp"
+#include "tpch.hpp"
+
+#include <iostream>
+#include <chrono>
+
+// Re-exports converted binary columns as dbgen-style .tbl files.
+// INPUT: directory containing the per-table column directories (e.g. output/)
+// OUTPUT: directory to write <table>.tbl files to
+template <typename table>
+void export_table(const RunConfig& cfg, const std::string& name, std::initializer_list<unsigned> integral = {}) {
+  auto start = std::chrono::steady_clock::now();
+  typename table::exporter exporter(cfg.input + name + "/");
+  for (auto col : integral) {
+    exporter.integral[col] = true;
+  }
+  auto bytes = exporter.write((cfg.output + name + ".tbl").c_str(), cfg.threads);
+  std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+  std::cout << "wrote " << exporter.row_count() << " rows (" << (bytes >> 20) << " MiB) for " << name
+            << " in " << secs.count() << "s (" << (bytes / secs.count() / (1 << 20)) << " MiB/s)" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    try {
+      auto cfg = read_config();
+      std::filesystem::create_directories(cfg.output);
+      export_table<tpch::nation>(cfg, "nation");
+      export_table<tpch::customer>(cfg, "customer");
+      export_table<tpch::lineitem>(cfg, "lineitem", {tpch::l_quantity});
+      export_table<tpch::orders>(cfg, "orders");
+      export_table<tpch::part>(cfg, "part");
+      export_table<tpch::partsupp>(cfg, "partsupp");
+      export_table<tpch::region>(cfg, "region");
+      export_table<tpch::supplier>(cfg, "supplier");
+    } catch (const char* error) {
+      std::cerr << "error: " << error << std::endl;
+      return 1;
+    }
+    return 0;
+}
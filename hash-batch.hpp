@@ -0,0 +1,185 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+#include "types.hpp"
+
+template <typename T>
+struct ColumnInput;
+
+/// Column-at-a-time hashing for hash joins and aggregations. The kernels
+/// fill a hash vector for a block of values instead of calling hashKey per
+/// value: 32- and 64-bit keys (Integer, BigInt, Date, Timestamp, Numeric)
+/// use multiply-xorshift four lanes at a time with AVX2, strings are hashed
+/// with the SSE4.2 crc32 instruction, and composite keys are hashed column
+/// by column into the same vector:
+///
+///   uint64_t hashes[n];
+///   hashing::hash_columns(n, hashes, &l_partkey[begin], &l_suppkey[begin]);
+///
+/// The hashes differ from hashKey and depend on the instruction set the
+/// program was built for, so they must not be persisted. Integer keys are
+/// sign-extended first, an Integer and a BigInt of the same value hash alike.
+/// NULLs are not handled, the stored value of a NULL is hashed.
+namespace hashing {
+
+    constexpr uint64_t K1 = 0x9e3779b97f4a7c15ull;
+    constexpr uint64_t K2 = 0xbf58476d1ce4e5b9ull;
+    // rotation of the running hash before a composite key column is mixed in
+    constexpr int COMBINE_ROTATION = 27;
+
+    inline uint64_t hash_int(uint64_t key) {
+        key *= K1;
+        key ^= key >> 29;
+        key *= K2;
+        key ^= key >> 32;
+        return key;
+    }
+
+    inline uint64_t load64(const char* data) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        return word;
+    }
+
+    inline uint32_t load32(const char* data) {
+        uint32_t word;
+        memcpy(&word, data, 4);
+        return word;
+    }
+
+    /// Runs two crc32 chains, the second over the words rotated by 32 bits so
+    /// the chains are independent, and mixes their 64 bits with hash_int. The
+    /// last partial word is read with loads that overlap the previous bytes,
+    /// only the first `len` bytes are read.
+    inline uint64_t hash_bytes(const char* data, size_t len) {
+        uint64_t a = len, b = ~len;
+        auto step = [&](uint64_t word) {
+#ifdef __SSE4_2__
+            a = _mm_crc32_u64(a, word);
+            b = _mm_crc32_u64(b, std::rotl(word, 32));
+#else
+            a = hash_int(a ^ word);
+            b = hash_int(b ^ std::rotl(word, 32));
+#endif
+        };
+        if (len >= 8) {
+            auto end = data + len;
+            for (; data + 8 <= end; data += 8) {
+                step(load64(data));
+            }
+            if (data != end) {
+                step(load64(end - 8));
+            }
+        } else if (len >= 4) {
+            step(load32(data) | static_cast<uint64_t>(load32(data + len - 4)) << 32);
+        } else if (len) {
+            step(static_cast<uint8_t>(data[0]) | static_cast<uint8_t>(data[len / 2]) << 8 | static_cast<uint8_t>(data[len - 1]) << 16);
+        }
+        return hash_int(a << 32 ^ b);
+    }
+
+    inline uint64_t combine(uint64_t hash, uint64_t next) {
+        return (std::rotl(hash, COMBINE_ROTATION) ^ next) * K1;
+    }
+
+    /// Types stored as a single 32- or 64-bit integer, hashed by the vector kernels.
+    template <typename T>
+    concept integer_key = requires(T v) { { v.value } -> std::convertible_to<int64_t>; } &&
+                          !requires(T v) { v.len; } && T::TAG != types::CHAR &&
+                          (sizeof(T) == 4 || sizeof(T) == 8) && sizeof(T) == sizeof(T::value);
+
+    template <typename T>
+    inline uint64_t hash(const T& value) {
+        if constexpr (requires { value.len; }) {
+            return hash_bytes(value.value, value.len);
+        } else if constexpr (T::TAG == types::CHAR) {
+            return hash_int(static_cast<uint8_t>(value.value));
+        } else {
+            return hash_int(static_cast<int64_t>(value.value));
+        }
+    }
+
+#ifdef __AVX2__
+    /// a * b mod 2^64 per lane, AVX2 only multiplies 32-bit halves.
+    inline __m256i mul64(__m256i a, uint64_t b) {
+        const __m256i b_lo = _mm256_set1_epi64x(b & 0xffffffff);
+        const __m256i b_hi = _mm256_set1_epi64x(b >> 32);
+        __m256i lo = _mm256_mul_epu32(a, b_lo);
+        __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b_lo), _mm256_mul_epu32(a, b_hi));
+        return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+    }
+
+    inline __m256i hash_int4(__m256i keys) {
+        keys = mul64(keys, K1);
+        keys = _mm256_xor_si256(keys, _mm256_srli_epi64(keys, 29));
+        keys = mul64(keys, K2);
+        return _mm256_xor_si256(keys, _mm256_srli_epi64(keys, 32));
+    }
+
+    /// Four keys sign-extended to 64 bits.
+    template <integer_key T>
+    inline __m256i load4(const T* values) {
+        if constexpr (sizeof(T) == 4) {
+            return _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+        } else {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+        }
+    }
+#endif
+
+    /// hashes[i] = hash(values[i]) for i < count.
+    template <typename T>
+    void hash_column(const T* values, size_t count, uint64_t* hashes) {
+        size_t i = 0;
+#ifdef __AVX2__
+        if constexpr (integer_key<T>) {
+            for (; i + 4 <= count; i += 4) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), hash_int4(load4(values + i)));
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            hashes[i] = hash(values[i]);
+        }
+    }
+
+    /// hashes[i] = combine(hashes[i], hash(values[i])) for i < count.
+    template <typename T>
+    void combine_column(const T* values, size_t count, uint64_t* hashes) {
+        size_t i = 0;
+#ifdef __AVX2__
+        if constexpr (integer_key<T>) {
+            for (; i + 4 <= count; i += 4) {
+                auto slot = reinterpret_cast<__m256i*>(hashes + i);
+                __m256i h = _mm256_loadu_si256(slot);
+                h = _mm256_or_si256(_mm256_slli_epi64(h, COMBINE_ROTATION), _mm256_srli_epi64(h, 64 - COMBINE_ROTATION));
+                h = mul64(_mm256_xor_si256(h, hash_int4(load4(values + i))), K1);
+                _mm256_storeu_si256(slot, h);
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            hashes[i] = combine(hashes[i], hash(values[i]));
+        }
+    }
+
+    /// Hashes the composite key made of the first `count` values of every column.
+    template <typename T, typename... Ts>
+    void hash_columns(size_t count, uint64_t* hashes, const T* first, const Ts*... rest) {
+        hash_column(first, count, hashes);
+        (combine_column(rest, count, hashes), ...);
+    }
+
+    /// Hashes rows [begin, end) of a mapped column.
+    template <typename T>
+    inline void hash_column(const ColumnInput<T>& column, size_t begin, size_t end, uint64_t* hashes) {
+        hash_column(&column[begin], end - begin, hashes);
+    }
+
+} // namespace hashing
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <span>
+
+/// Structured reporting of malformed input. Workers record errors in their
+/// own log while parsing with tryCastString, the logs are merged into a
+/// report once the table has been read.
+namespace ingest {
+
+    enum class Policy : uint8_t {
+        // stop at the first error and write nothing
+        STOP,
+        // drop rows with errors
+        SKIP,
+        // keep rows, invalid values become NULL or zero
+        CONTINUE
+    };
+    constexpr char const* POLICY_NAMES[] = { "stop", "skip", "continue" };
+
+    inline Policy parse_policy(std::string_view name) {
+        for (auto p = 0u; p != std::size(POLICY_NAMES); ++p) {
+            if (name == POLICY_NAMES[p]) {
+                return static_cast<Policy>(p);
+            }
+        }
+        throw "unknown error policy, use stop, skip or continue";
+    }
+
+    struct Error {
+        // 1-based line of the input file
+        size_t line;
+        unsigned column;
+        // byte offset of the field in the input file
+        size_t offset;
+        const char* reason;
+
+        bool operator<(const Error& other) const { return line < other.line || (line == other.line && column < other.column); }
+    };
+
+    /// Errors of one worker; only the first MAX_RECORDED are kept, all are counted.
+    struct WorkerLog {
+        static constexpr size_t MAX_RECORDED = 100;
+
+        std::vector<Error> errors;
+        size_t count = 0;
+        size_t skipped_rows = 0;
+
+        inline void record(size_t line, unsigned column, size_t offset, const char* reason) {
+            if (errors.size() < MAX_RECORDED) {
+                errors.push_back(Error{line, column, offset, reason});
+            }
+            ++count;
+        }
+    };
+
+    struct Report {
+        std::vector<Error> errors;
+        size_t count = 0;
+        size_t skipped_rows = 0;
+        bool stopped = false;
+
+        void merge(const std::vector<WorkerLog>& logs) {
+            for (auto& log : logs) {
+                errors.insert(errors.end(), log.errors.begin(), log.errors.end());
+                count += log.count;
+                skipped_rows += log.skipped_rows;
+            }
+            std::sort(errors.begin(), errors.end());
+            if (errors.size() > WorkerLog::MAX_RECORDED) {
+                errors.resize(WorkerLog::MAX_RECORDED);
+            }
+        }
+
+        void print(std::ostream& out, std::string_view table, std::span<const char* const> columns) const {
+            for (auto& error : errors) {
+                out << table << ":" << error.line << ": column " << columns[error.column] << " at byte "
+                    << error.offset << ": " << error.reason << "\n";
+            }
+            out << table << ": " << count << " errors";
+            if (count > errors.size()) {
+                out << " (" << errors.size() << " shown)";
+            }
+            if (skipped_rows) {
+                out << ", " << skipped_rows << " rows skipped";
+            }
+            if (stopped) {
+                out << ", conversion stopped";
+            }
+            out << std::endl;
+        }
+    };
+
+} // namespace ingest
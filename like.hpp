@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "types.hpp"
+#include "common.hpp"
+
+/// Batch evaluation of SQL LIKE patterns over whole string columns. A
+/// pattern is split at '%' into an anchored prefix, an anchored suffix and
+/// unanchored segments that must occur in order, e.g. '%special%requests%'.
+/// Patterns with the single-byte wildcard '_' or a '\' escape, e.g.
+/// 'a_c' or '100\%', are matched byte by byte instead. Results are
+/// selection bitmaps with one bit per row.
+namespace like {
+
+    using bitmap_t = std::vector<uint64_t>;
+
+    struct Pattern {
+        std::string prefix;
+        std::string suffix;
+        std::vector<std::string> segments;
+        // pattern without '%', compared for equality
+        bool exact = false;
+        // pattern with '_' or '\', matched by match_wildcards
+        bool wildcards = false;
+        std::string raw;
+        // bytes matched by a pattern with wildcards, all but '%' and escapes
+        size_t raw_length = 0;
+        // prefix zero-padded for vector compares
+        char prefix_block[32] = {};
+
+        static Pattern parse(std::string_view pattern) {
+            Pattern p;
+            if (pattern.find_first_of("_\\") != std::string_view::npos) {
+                p.wildcards = true;
+                p.raw = pattern;
+                for (size_t i = 0; i < pattern.size(); ++i) {
+                    bool escaped = pattern[i] == '\\' && i + 1 < pattern.size();
+                    i += escaped;
+                    p.raw_length += escaped || pattern[i] != '%';
+                }
+                return p;
+            }
+            auto first = pattern.find('%');
+            if (first == std::string_view::npos) {
+                p.prefix = pattern;
+                p.exact = true;
+                p.fill_block();
+                return p;
+            }
+            auto last = pattern.rfind('%');
+            p.prefix = pattern.substr(0, first);
+            p.fill_block();
+            p.suffix = pattern.substr(last + 1);
+            for (auto pos = first + 1; pos < last;) {
+                auto next = pattern.find('%', pos);
+                if (next > pos) {
+                    p.segments.emplace_back(pattern.substr(pos, next - pos));
+                }
+                pos = next + 1;
+            }
+            return p;
+        }
+
+        inline void fill_block() {
+            memcpy(prefix_block, prefix.data(), std::min<size_t>(prefix.size(), sizeof(prefix_block)));
+        }
+
+        inline size_t min_length() const {
+            if (wildcards) {
+                return raw_length;
+            }
+            auto len = prefix.size() + suffix.size();
+            for (auto& seg : segments) {
+                len += seg.size();
+            }
+            return len;
+        }
+    };
+
+    inline size_t popcount(const bitmap_t& bitmap) {
+        size_t count = 0;
+        for (auto word : bitmap) {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+
+    inline bool test(const bitmap_t& bitmap, size_t row) {
+        return (bitmap[row / 64] >> (row % 64)) & 1;
+    }
+
+    /// Position of `needle` in [str, str + len) or nullptr. `readable` is the
+    /// end of the memory that may be loaded from, vector loads are only used
+    /// while they stay in bounds.
+    inline const char* find(const char* str, size_t len, const char* needle, size_t needle_len, const char* readable) {
+        if (needle_len == 0) {
+            return str;
+        }
+        if (needle_len > len) {
+            return nullptr;
+        }
+#ifdef __AVX2__
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+        const size_t candidates = len - needle_len + 1;
+        size_t pos = 0;
+        for (; pos < candidates && str + pos + needle_len - 1 + 32 <= readable; pos += 32) {
+            __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + pos));
+            __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + pos + needle_len - 1));
+            uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                                  _mm256_cmpeq_epi8(block_last, last)));
+            if (candidates - pos < 32) {
+                mask &= (1u << (candidates - pos)) - 1;
+            }
+            while (mask) {
+                auto bit = __builtin_ctz(mask);
+                if (needle_len <= 2 || memcmp(str + pos + bit + 1, needle + 1, needle_len - 2) == 0) {
+                    return str + pos + bit;
+                }
+                mask &= mask - 1;
+            }
+        }
+        if (pos >= candidates) {
+            return nullptr;
+        }
+        return static_cast<const char*>(memmem(str + pos, len - pos, needle, needle_len));
+#else
+        return static_cast<const char*>(memmem(str, len, needle, needle_len));
+#endif
+    }
+
+    /// Compares the pattern prefix with one vector compare where possible.
+    inline bool equal_prefix(const char* str, const Pattern& p, const char* readable) {
+        auto len = p.prefix.size();
+#ifdef __AVX2__
+        if (len <= 32 && str + 32 <= readable) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p.prefix_block));
+            uint32_t eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+            uint32_t care = len == 32 ? ~0u : (1u << len) - 1;
+            return (eq & care) == care;
+        }
+#endif
+        return memcmp(str, p.prefix.data(), len) == 0;
+    }
+
+    /// Matches a pattern with '%', '_' and '\' escapes, backtracking to the
+    /// last '%' on a mismatch.
+    inline bool match_wildcards(std::string_view pattern, const char* str, size_t len) {
+        size_t p = 0, s = 0, star = std::string_view::npos, star_s = 0;
+        while (s < len) {
+            if (p < pattern.size() && pattern[p] == '%') {
+                star = ++p;
+                star_s = s;
+                continue;
+            }
+            if (p < pattern.size()) {
+                bool escaped = pattern[p] == '\\' && p + 1 < pattern.size();
+                char c = pattern[p + escaped];
+                if ((c == '_' && !escaped) || c == str[s]) {
+                    p += 1 + escaped;
+                    ++s;
+                    continue;
+                }
+            }
+            if (star == std::string_view::npos) {
+                return false;
+            }
+            p = star;
+            s = ++star_s;
+        }
+        while (p < pattern.size() && pattern[p] == '%') {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+    inline bool match(const Pattern& p, const char* str, size_t len, const char* readable) {
+        if (p.wildcards) {
+            return len >= p.min_length() && match_wildcards(p.raw, str, len);
+        }
+        if (p.exact) {
+            return len == p.prefix.size() && equal_prefix(str, p, readable);
+        }
+        if (len < p.min_length()) {
+            return false;
+        }
+        if (!p.prefix.empty() && !equal_prefix(str, p, readable)) {
+            return false;
+        }
+        if (!p.suffix.empty() && memcmp(str + len - p.suffix.size(), p.suffix.data(), p.suffix.size()) != 0) {
+            return false;
+        }
+        const char* pos = str + p.prefix.size();
+        const char* end = str + len - p.suffix.size();
+        for (auto& seg : p.segments) {
+            auto found = find(pos, end - pos, seg.data(), seg.size(), readable);
+            if (!found) {
+                return false;
+            }
+            pos = found + seg.size();
+        }
+        return true;
+    }
+
+    /// Fixed-size Char/Varchar slots as written by ColumnOutput.
+    template <typename T>
+    struct SlotStrings {
+        const T* items;
+        size_t count;
+
+        SlotStrings(const T* items, size_t count) : items(items), count(count) {}
+        SlotStrings(const ColumnInput<T>& column) : SlotStrings(column.page.begin(), column.size()) {}
+
+        inline size_t size() const { return count; }
+        inline const char* data(size_t row) const { return items[row].value; }
+        inline size_t length(size_t row) const { return items[row].len; }
+        inline const char* readable(size_t) const { return reinterpret_cast<const char*>(items + count); }
+        // slots always need the string data
+        inline bool prefix_only(const Pattern&, size_t, bool&) const { return false; }
+    };
+
+    /// Strings in the InlineString layout; rows that are too short or differ
+    /// in the first four bytes of the prefix are rejected on the headers.
+    struct InlineStrings {
+        const types::InlineString* headers;
+        const char* heap;
+        size_t count;
+        const char* heap_end;
+
+        InlineStrings(const InlineStringInput& column)
+            : headers(column.headers.begin()), heap(column.heap_data()), count(column.size())
+            , heap_end(column.heap_data() + column.heap.size()) {}
+
+        inline size_t size() const { return count; }
+        inline const char* data(size_t row) const { return headers[row].begin(heap); }
+        inline size_t length(size_t row) const { return headers[row].len; }
+        inline const char* readable(size_t row) const {
+            return headers[row].isInline() ? reinterpret_cast<const char*>(headers + count) : heap_end;
+        }
+        inline bool prefix_only(const Pattern& p, size_t row, bool& result) const {
+            auto& str = headers[row];
+            auto head = std::min<size_t>(p.prefix.size(), types::InlineString::PREFIX_LEN);
+            if (str.len < p.min_length() || memcmp(str.prefix, p.prefix.data(), head) != 0) {
+                result = false;
+                return true;
+            }
+            if (p.exact || p.wildcards || !p.suffix.empty() || !p.segments.empty() || p.prefix.size() > types::InlineString::PREFIX_LEN) {
+                return false;
+            }
+            result = true;
+            return true;
+        }
+    };
+
+    /// Evaluates the pattern on rows [begin, end), begin must be a multiple of 64.
+    template <typename Strings>
+    void evaluate(const Strings& strings, const Pattern& pattern, bitmap_t& result, size_t begin, size_t end) {
+        for (auto word = begin / 64; word * 64 < end; ++word) {
+            uint64_t bits = 0;
+            auto limit = std::min<size_t>(64, end - word * 64);
+            for (auto bit = 0u; bit != limit; ++bit) {
+                auto row = word * 64 + bit;
+                bool matches;
+                if (!strings.prefix_only(pattern, row, matches)) {
+                    matches = match(pattern, strings.data(row), strings.length(row), strings.readable(row));
+                }
+                bits |= static_cast<uint64_t>(matches) << bit;
+            }
+            result[word] = bits;
+        }
+    }
+
+    /// Selection bitmap of all rows matching `pattern`, computed on `threads` workers.
+    template <typename Strings>
+    bitmap_t evaluate(const Strings& strings, std::string_view pattern, unsigned threads = 1) {
+        static constexpr size_t MORSEL_ROWS = 64 * 1024;
+        auto p = Pattern::parse(pattern);
+        auto rows = strings.size();
+        bitmap_t result((rows + 63) / 64);
+        std::atomic<size_t> next = 0;
+        run_workers(threads, [&](unsigned) {
+            for (auto begin = next.fetch_add(MORSEL_ROWS); begin < rows; begin = next.fetch_add(MORSEL_ROWS)) {
+                evaluate(strings, p, result, begin, std::min(rows, begin + MORSEL_ROWS));
+            }
+        });
+        return result;
+    }
+
+    template <typename T>
+    bitmap_t evaluate(const ColumnInput<T>& column, std::string_view pattern, unsigned threads = 1) {
+        return evaluate(SlotStrings<T>(column), pattern, threads);
+    }
+
+    inline bitmap_t evaluate(const InlineStringInput& column, std::string_view pattern, unsigned threads = 1) {
+        return evaluate(InlineStrings(column), pattern, threads);
+    }
+
+} // namespace like
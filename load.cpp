@@ -0,0 +1,74 @@
+#include "csv-read/csv.hpp"
+#include "common.hpp"
+#include "load.hpp"
+
+#include <iostream>
+#include <chrono>
+
+// Loads the TPC-H tables into memory with load.hpp, without writing column
+// files, and cross-checks a projected load of lineitem against the full one.
+// INPUT: directory containing the .tbl files
+// THREADS, PROJECT, FILTER, SAMPLE_KEY and ERRORS apply as for all.out.
+
+template <typename Table>
+bool check_table(const std::string& name, std::span<const char* const> columns, const Table& table) {
+    if (table.report.count) {
+      table.report.print(std::cerr, name, columns);
+    }
+    // columns outside the projection are empty, the others have every row
+    bool complete = std::apply([&](auto&... column) {
+      return ((column.size() == table.rows || column.size() == 0) && ...);
+    }, table.columns);
+    std::cout << "loaded " << table.rows << " rows for " << name << (complete ? "" : ", column sizes MISMATCH") << std::endl;
+    return complete;
+}
+
+int main(int argc, char *argv[]) {
+    bool ok = true;
+    try {
+      auto cfg = read_config();
+      auto start = std::chrono::steady_clock::now();
+      auto db = load::TPCH::read(cfg);
+      std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+      ok &= check_table("nation", tpch::nation_c, db.nation);
+      ok &= check_table("customer", tpch::customer_c, db.customer);
+      ok &= check_table("lineitem", tpch::lineitem_c, db.lineitem);
+      ok &= check_table("orders", tpch::orders_c, db.orders);
+      ok &= check_table("part", tpch::part_c, db.part);
+      ok &= check_table("partsupp", tpch::partsupp_c, db.partsupp);
+      ok &= check_table("region", tpch::region_c, db.region);
+      ok &= check_table("supplier", tpch::supplier_c, db.supplier);
+      std::cout << "loaded all tables in " << secs.count() << "s" << std::endl;
+
+      auto& comments = db.nation.column<tpch::n_comment>();
+      size_t nulls = 0;
+      for (auto row = 0ul; row != comments.size(); ++row) {
+        nulls += comments.is_null(row);
+      }
+      std::cout << "nation: " << nulls << " NULL comments" << std::endl;
+
+      // a single column of lineitem on its own must sum up like the full load
+      auto& prices = db.lineitem.column<tpch::l_extendedprice>();
+      if (prices.size() == db.lineitem.rows) {
+        auto options = cfg.table_options("lineitem", tpch::lineitem_c);
+        options.projection &= 1ull << tpch::l_extendedprice;
+        auto projected = load::table_t<tpch::lineitem>::read(cfg.input + "lineitem.tbl", options);
+        int64_t full = 0, single = 0;
+        for (auto& price : prices) {
+          full += price.value;
+        }
+        for (auto& price : projected.column<tpch::l_extendedprice>()) {
+          single += price.value;
+        }
+        bool match = projected.rows == db.lineitem.rows && single == full
+                     && projected.column<tpch::l_orderkey>().size() == 0;
+        std::cout << "lineitem: l_extendedprice sum " << full << ", projected load " << single << " "
+                  << (match ? "ok" : "MISMATCH") << std::endl;
+        ok &= match;
+      }
+    } catch (const char* error) {
+      std::cerr << "error: " << error << std::endl;
+      return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <utility>
+#include "types.hpp"
+#include "common.hpp"
+#include "tpch.hpp"
+
+/// Loads .tbl files straight into memory for query engines, with the same
+/// parallel parser, projections, filters, sampling and error policies as the
+/// converter but without writing or re-mapping column files:
+///
+///   auto lineitem = load::Table<...>::read("lineitem.tbl", options);
+///   auto db = load::TPCH::read(read_config());
+///   for (auto& price : db.lineitem.column<tpch::l_extendedprice>()) ...
+///
+/// The buffers are owned by the returned objects. Columns outside a
+/// projection are empty.
+namespace load {
+
+    template <typename T>
+    struct Column {
+        using value_t = T;
+
+        std::vector<T, memory::StagingAllocator<T>> values;
+
+        Column() = default;
+        explicit Column(ColumnOutput<T>&& output) : values(std::move(output.items)) {}
+
+        inline size_t size() const { return values.size(); }
+        inline const T* data() const { return values.data(); }
+        inline const T& operator[](size_t row) const { return values[row]; }
+        inline auto begin() const { return values.begin(); }
+        inline auto end() const { return values.end(); }
+    };
+
+    /// Values are stored like the non-null column, NULLs in a bitmap.
+    template <typename T>
+    struct Column<types::Nullable<T>> : Column<T> {
+        using value_t = types::Nullable<T>;
+
+        // bit set = NULL, all words zero if the column has no NULLs
+        std::vector<uint64_t> nulls;
+
+        Column() = default;
+        explicit Column(ColumnOutput<value_t>&& output) : Column<T>(std::move(output)), nulls(std::move(output.nulls)) {}
+
+        inline bool is_null(size_t row) const {
+            return row / 64 < nulls.size() && (nulls[row / 64] >> (row % 64)) & 1;
+        }
+
+        inline value_t operator[](size_t row) const {
+            return is_null(row) ? value_t::makeNull() : value_t(this->values[row]);
+        }
+    };
+
+    template <typename... Ts>
+    struct Table {
+        std::tuple<Column<Ts>...> columns;
+        size_t rows = 0;
+        // malformed fields skipped or replaced under ERRORS=skip|continue
+        ingest::Report report;
+
+        template <size_t I>
+        inline auto& column() { return std::get<I>(columns); }
+        template <size_t I>
+        inline const auto& column() const { return std::get<I>(columns); }
+
+        /// Parses a file with options.threads workers. Throws if the input
+        /// has malformed fields and options.errors is STOP.
+        static Table read(const std::string& filename, const ConvertOptions& options = {}) {
+            TableImport<Ts...> import(filename.c_str(), options);
+            Table result;
+            result.rows = import.read();
+            if (import.failed) {
+                throw "malformed input, loading stopped";
+            }
+            result.report = std::move(import.report);
+            result.columns = take(import.outputs, std::index_sequence_for<Ts...>{});
+            return result;
+        }
+
+    private:
+        template <size_t... Is>
+        static std::tuple<Column<Ts>...> take(std::tuple<ColumnOutput<Ts>...>& outputs, std::index_sequence<Is...>) {
+            return std::tuple<Column<Ts>...>(Column<Ts>(std::move(std::get<Is>(outputs)))...);
+        }
+    };
+
+    /// The in-memory table of a tpch::TableDef.
+    template <typename Def>
+    struct table_of;
+    template <typename... Ts>
+    struct table_of<tpch::TableDef<Ts...>> { using type = Table<Ts...>; };
+    template <typename Def>
+    using table_t = typename table_of<Def>::type;
+
+    /// All eight TPC-H tables.
+    struct TPCH {
+        table_t<tpch::nation> nation;
+        table_t<tpch::customer> customer;
+        table_t<tpch::lineitem> lineitem;
+        table_t<tpch::orders> orders;
+        table_t<tpch::part> part;
+        table_t<tpch::partsupp> partsupp;
+        table_t<tpch::region> region;
+        table_t<tpch::supplier> supplier;
+
+        /// Loads <table>.tbl from cfg.input with the options of cfg, including
+        /// its per-table PROJECT, FILTER and SAMPLE_KEY entries.
+        static TPCH read(const RunConfig& cfg) {
+            TPCH db;
+            read_table<tpch::nation>(cfg, "nation", tpch::nation_c, db.nation);
+            read_table<tpch::customer>(cfg, "customer", tpch::customer_c, db.customer);
+            read_table<tpch::lineitem>(cfg, "lineitem", tpch::lineitem_c, db.lineitem);
+            read_table<tpch::orders>(cfg, "orders", tpch::orders_c, db.orders);
+            read_table<tpch::part>(cfg, "part", tpch::part_c, db.part);
+            read_table<tpch::partsupp>(cfg, "partsupp", tpch::partsupp_c, db.partsupp);
+            read_table<tpch::region>(cfg, "region", tpch::region_c, db.region);
+            read_table<tpch::supplier>(cfg, "supplier", tpch::supplier_c, db.supplier);
+            return db;
+        }
+
+    private:
+        template <typename Def>
+        static void read_table(const RunConfig& cfg, const std::string& name, std::span<const char* const> columns, table_t<Def>& table) {
+            table = table_t<Def>::read(cfg.input + name + ".tbl", cfg.table_options(name, columns));
+        }
+    };
+
+} // namespace load
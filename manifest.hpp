@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <sys/stat.h>
+#include "types.hpp"
+#include "common.hpp"
+
+/// Per-table conversion manifest, stored as <output>/<table>/manifest. It
+/// records the input file's size, mtime and content hash, the converter
+/// version and options, and the size of every output file, so reruns can
+/// skip tables whose input and outputs are unchanged.
+namespace manifest {
+
+    // bump whenever the output format of any column changes
+    static constexpr unsigned CONVERTER_VERSION = 1;
+    static constexpr const char* FILE_NAME = "manifest";
+
+    struct Input {
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+
+        static Input stat(const std::string& path) {
+            struct stat st;
+            Input info;
+            if (::stat(path.c_str(), &st) == 0) {
+                info.size = st.st_size;
+                info.mtime_ns = st.st_mtim.tv_sec * 1000000000l + st.st_mtim.tv_nsec;
+            }
+            return info;
+        }
+    };
+
+    /// Hash of the input contents. Blocks are hashed in parallel with four
+    /// independent multiply-rotate lanes and combined in block order.
+    inline uint64_t hash_file(const std::string& path, unsigned threads) {
+        static constexpr size_t HASH_BLOCK = 4 << 20;
+        static constexpr uint64_t P1 = 0x9e3779b185ebca87ull, P2 = 0xc2b2ae3d27d4eb4full;
+        io::MMapping<char> input(path.c_str());
+        const char* data = input.data();
+        size_t size = input.size();
+        size_t blocks = (size + HASH_BLOCK - 1) / HASH_BLOCK;
+        std::vector<uint64_t> block_hashes(blocks);
+        std::atomic<size_t> next = 0;
+        run_workers(threads, [&](unsigned) {
+            for (auto block = next++; block < blocks; block = next++) {
+                auto begin = block * HASH_BLOCK, end = std::min(size, begin + HASH_BLOCK);
+                uint64_t lanes[4] = { P1, P2, P1 ^ P2, ~P1 };
+                auto pos = begin;
+                for (; pos + 32 <= end; pos += 32) {
+                    for (auto l = 0; l != 4; ++l) {
+                        uint64_t word;
+                        memcpy(&word, data + pos + 8 * l, 8);
+                        lanes[l] = ((lanes[l] + word * P2) << 31 | (lanes[l] + word * P2) >> 33) * P1;
+                    }
+                }
+                uint64_t tail = 0;
+                for (; pos != end; ++pos) {
+                    tail = (tail << 8 | static_cast<unsigned char>(data[pos])) * P1;
+                }
+                uint64_t h = types::murmurHash64(lanes[0] ^ types::murmurHash64(lanes[1] ^ types::murmurHash64(lanes[2] ^ lanes[3])));
+                block_hashes[block] = types::murmurHash64(h ^ tail ^ (end - begin));
+            }
+        });
+        uint64_t hash = size;
+        for (auto h : block_hashes) {
+            hash = types::murmurHash64(hash ^ h);
+        }
+        return hash;
+    }
+
+    /// Hash of a short text such as a schema description.
+    inline uint64_t hash_string(std::string_view text) {
+        uint64_t hash = text.size();
+        for (char c : text) {
+            hash = types::murmurHash64(hash ^ static_cast<unsigned char>(c));
+        }
+        return hash;
+    }
+
+    struct Manifest {
+        unsigned version = 0;
+        std::string options;
+        Input input;
+        uint64_t input_hash = 0;
+        uint64_t rows = 0;
+        std::vector<std::pair<std::string, uint64_t>> files;
+
+        static std::string path(const std::string& dir) { return dir + FILE_NAME; }
+
+        static bool load(const std::string& dir, Manifest& m) {
+            std::ifstream in(path(dir));
+            if (!in) {
+                return false;
+            }
+            std::string line;
+            while (std::getline(in, line)) {
+                std::istringstream fields(line);
+                std::string key;
+                fields >> key;
+                if (key == "version") fields >> m.version;
+                else if (key == "options") std::getline(fields >> std::ws, m.options);
+                else if (key == "input_size") fields >> m.input.size;
+                else if (key == "input_mtime_ns") fields >> m.input.mtime_ns;
+                else if (key == "input_hash") fields >> std::hex >> m.input_hash;
+                else if (key == "rows") fields >> m.rows;
+                else if (key == "file") {
+                    std::string name;
+                    uint64_t size;
+                    fields >> name >> size;
+                    m.files.emplace_back(name, size);
+                }
+            }
+            return true;
+        }
+
+        void save(const std::string& dir) const {
+            std::ofstream out(path(dir));
+            out << "version " << version << "\n"
+                << "options " << options << "\n"
+                << "input_size " << input.size << "\n"
+                << "input_mtime_ns " << input.mtime_ns << "\n"
+                << "input_hash " << std::hex << input_hash << std::dec << "\n"
+                << "rows " << rows << "\n";
+            for (auto& [name, size] : files) {
+                out << "file " << name << " " << size << "\n";
+            }
+        }
+
+        /// Records all output files currently in `dir`.
+        void scan_outputs(const std::string& dir) {
+            files.clear();
+            for (auto& entry : std::filesystem::directory_iterator(dir)) {
+                auto name = entry.path().filename().string();
+                if (entry.is_regular_file() && name != FILE_NAME) {
+                    files.emplace_back(name, entry.file_size());
+                }
+            }
+            std::sort(files.begin(), files.end());
+        }
+
+        /// Are all recorded outputs present with their recorded sizes?
+        bool outputs_valid(const std::string& dir) const {
+            if (files.empty()) {
+                return false;
+            }
+            for (auto& [name, size] : files) {
+                std::error_code ec;
+                if (std::filesystem::file_size(dir + name, ec) != size || ec) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    /// Decides whether a table needs to be converted again. Size and mtime
+    /// are checked first, the content hash only if they changed. With
+    /// `force` the table is never up to date and the input is hashed by
+    /// `commit` instead.
+    struct Check {
+        Manifest previous;
+        Manifest current;
+        bool up_to_date = false;
+        std::string input_path;
+        unsigned threads;
+        bool hashed = false;
+
+        Check(const std::string& input_path, const std::string& output_dir, const std::string& options, unsigned threads,
+              bool force = false)
+            : input_path(input_path), threads(threads) {
+            current.version = CONVERTER_VERSION;
+            current.options = options;
+            current.input = Input::stat(input_path);
+            bool loaded = Manifest::load(output_dir, previous);
+            if (force) {
+                return;
+            }
+            bool same_config = loaded && previous.version == current.version && previous.options == current.options;
+            if (same_config && previous.input.size == current.input.size && previous.input.mtime_ns == current.input.mtime_ns) {
+                current.input_hash = previous.input_hash;
+            } else {
+                current.input_hash = hash_file(input_path, threads);
+            }
+            hashed = true;
+            up_to_date = same_config && previous.input.size == current.input.size && previous.input_hash == current.input_hash
+                         && previous.outputs_valid(output_dir);
+        }
+
+        /// Keeps the manifest of an up-to-date table current if only the
+        /// input's mtime changed, so the next run does not hash it again.
+        void refresh(const std::string& output_dir) {
+            if (previous.input.mtime_ns != current.input.mtime_ns) {
+                current.rows = previous.rows;
+                current.files = previous.files;
+                current.save(output_dir);
+            }
+        }
+
+        /// Marks the outputs as incomplete until `commit` and removes the
+        /// previous outputs, which may not be written again with new options.
+        void invalidate(const std::string& output_dir) {
+            std::error_code ec;
+            std::filesystem::remove(Manifest::path(output_dir), ec);
+            for (auto& [name, size] : previous.files) {
+                std::filesystem::remove(output_dir + name, ec);
+            }
+        }
+
+        /// Writes the manifest after all outputs of the table are complete.
+        void commit(const std::string& output_dir, uint64_t rows) {
+            if (!hashed) {
+                current.input_hash = hash_file(input_path, threads);
+                hashed = true;
+            }
+            current.rows = rows;
+            current.scan_outputs(output_dir);
+            current.save(output_dir);
+        }
+    };
+
+} // namespace manifest
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fstream>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <linux/mempolicy.h>
+
+namespace memory {
+
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // set from ConvertOptions before any staging memory is allocated
+    inline bool use_hugepages = false;
+
+    /// Requests transparent huge pages for the 2 MiB aligned part of a range.
+    inline void advise_hugepages(void* addr, size_t len) {
+        auto begin = (reinterpret_cast<uintptr_t>(addr) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        auto end = (reinterpret_cast<uintptr_t>(addr) + len) & ~(HUGE_PAGE_SIZE - 1);
+        if (begin < end) {
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+        }
+    }
+
+    /// Drops the whole pages of [addr, addr + len) from the address space,
+    /// file-backed pages are read again from the page cache if needed.
+    inline void release(const void* addr, size_t len) {
+        auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        auto begin = (reinterpret_cast<uintptr_t>(addr) + page - 1) & ~(page - 1);
+        auto end = (reinterpret_cast<uintptr_t>(addr) + len) & ~(page - 1);
+        if (begin < end) {
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+        }
+    }
+
+    /// Keeps large staging buffers for the next table instead of unmapping
+    /// them. Their pages are already faulted in, so a reused buffer saves
+    /// the page faults and the kernel zeroing fresh anonymous memory. Sizes
+    /// are rounded to huge pages and a request takes the smallest cached
+    /// buffer of at most twice its size. At most `limit` bytes are cached,
+    /// none unless a converter sets it, so library users get their memory
+    /// back when their tables are destroyed.
+    class Pool {
+        std::mutex mutex;
+        std::multimap<size_t, void*> cached;
+        // mapped size of every buffer handed out
+        std::unordered_map<void*, size_t> mapped;
+        size_t cached_bytes = 0;
+        size_t reused_bytes = 0;
+
+    public:
+        size_t limit = 0;
+
+        /// A quarter of the physical memory, what the converters cache
+        /// unless POOL says otherwise.
+        static size_t default_limit() {
+            return static_cast<size_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE) / 4;
+        }
+
+        /// Never destroyed, buffers may be released by static destructors.
+        static Pool& get() {
+            static Pool& pool = *new Pool();
+            return pool;
+        }
+
+        void* allocate(size_t bytes) {
+            bytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+            {
+                std::lock_guard lock(mutex);
+                auto fit = cached.lower_bound(bytes);
+                if (fit != cached.end() && fit->first <= 2 * bytes) {
+                    auto [size, ptr] = *fit;
+                    cached.erase(fit);
+                    cached_bytes -= size;
+                    reused_bytes += size;
+                    mapped.emplace(ptr, size);
+                    return ptr;
+                }
+            }
+            void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            if (use_hugepages) {
+                advise_hugepages(ptr, bytes);
+            }
+            std::lock_guard lock(mutex);
+            mapped.emplace(ptr, bytes);
+            return ptr;
+        }
+
+        void deallocate(void* ptr) {
+            std::unique_lock lock(mutex);
+            auto it = mapped.find(ptr);
+            auto size = it->second;
+            mapped.erase(it);
+            if (cached_bytes + size <= limit) {
+                cached.emplace(size, ptr);
+                cached_bytes += size;
+                return;
+            }
+            lock.unlock();
+            munmap(ptr, size);
+        }
+
+        /// Bytes of buffers handed out again so far.
+        size_t reused() {
+            std::lock_guard lock(mutex);
+            return reused_bytes;
+        }
+    };
+
+    /// Allocator for column staging buffers. Large allocations come from the
+    /// Pool (optionally backed by huge pages) and, like all allocations, are
+    /// not touched on construction: the first thread writing a fresh page
+    /// decides its NUMA node, Topology::place moves reused ones.
+    template <typename T>
+    struct StagingAllocator {
+        using value_type = T;
+        static constexpr size_t MMAP_THRESHOLD = HUGE_PAGE_SIZE;
+
+        StagingAllocator() = default;
+        template <typename U> StagingAllocator(const StagingAllocator<U>&) {}
+
+        T* allocate(size_t n) {
+            auto bytes = n * sizeof(T);
+            if (bytes < MMAP_THRESHOLD) {
+                return static_cast<T*>(::operator new(bytes));
+            }
+            return static_cast<T*>(Pool::get().allocate(bytes));
+        }
+
+        void deallocate(T* ptr, size_t n) {
+            auto bytes = n * sizeof(T);
+            if (bytes < MMAP_THRESHOLD) {
+                ::operator delete(ptr);
+            } else {
+                Pool::get().deallocate(ptr);
+            }
+        }
+
+        // column values are implicit-lifetime types, leave new elements untouched
+        template <typename U>
+        void construct(U* ptr) {
+            static_assert(std::is_trivially_copyable_v<U>);
+        }
+        template <typename U, typename... Args>
+        void construct(U* ptr, Args&&... args) {
+            ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+        }
+
+        template <typename U> bool operator==(const StagingAllocator<U>&) const { return true; }
+        template <typename U> bool operator!=(const StagingAllocator<U>&) const { return false; }
+    };
+
+    // parses lists like "0-3,8-11" from sysfs
+    inline std::vector<unsigned> parse_cpu_list(const std::string& list) {
+        std::vector<unsigned> result;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            auto end = list.find(',', pos);
+            if (end == std::string::npos) end = list.size();
+            auto range = list.substr(pos, end - pos);
+            auto dash = range.find('-');
+            if (!range.empty()) {
+                unsigned first = std::stoul(range.substr(0, dash));
+                unsigned last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+                for (auto cpu = first; cpu <= last; ++cpu) {
+                    result.push_back(cpu);
+                }
+            }
+            pos = end + 1;
+        }
+        return result;
+    }
+
+    /// NUMA topology from sysfs, a single node if it is not available.
+    struct Topology {
+        std::vector<std::vector<unsigned>> node_cpus;
+
+        Topology() {
+            std::ifstream online("/sys/devices/system/node/online");
+            std::string list;
+            if (online && std::getline(online, list)) {
+                for (auto node : parse_cpu_list(list)) {
+                    std::ifstream cpus("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                    std::string cpu_list;
+                    if (cpus && std::getline(cpus, cpu_list) && !cpu_list.empty()) {
+                        node_cpus.push_back(parse_cpu_list(cpu_list));
+                    }
+                }
+            }
+            if (node_cpus.empty()) {
+                node_cpus.emplace_back();
+            }
+        }
+
+        inline unsigned nodes() const { return node_cpus.size(); }
+
+        /// Workers are spread round-robin over the nodes.
+        inline unsigned node_of_worker(unsigned worker) const { return worker % nodes(); }
+
+        /// Pins the calling thread to the CPUs of the node of `worker`.
+        void pin_worker(unsigned worker) const {
+            auto& cpus = node_cpus[node_of_worker(worker)];
+            if (nodes() < 2 || cpus.empty()) {
+                return;
+            }
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (auto cpu : cpus) {
+                CPU_SET(cpu, &set);
+            }
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+
+        /// Prefers the node of `worker` for the pages of [addr, addr + len) and
+        /// moves pages a reused buffer has elsewhere.
+        void place(void* addr, size_t len, unsigned worker) const {
+            if (nodes() < 2 || !len) {
+                return;
+            }
+            auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+            auto begin = (reinterpret_cast<uintptr_t>(addr) + page - 1) & ~(page - 1);
+            auto end = (reinterpret_cast<uintptr_t>(addr) + len) & ~(page - 1);
+            if (begin >= end) {
+                return;
+            }
+            unsigned long mask = 1ul << node_of_worker(worker);
+            syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED, &mask, sizeof(mask) * 8, MPOL_MF_MOVE);
+        }
+
+        static const Topology& get() {
+            static Topology topology;
+            return topology;
+        }
+    };
+
+    /// Counters for the benchmark output of a conversion step.
+    struct Usage {
+        long minor_faults;
+        long major_faults;
+        long huge_kb;
+
+        static long anon_huge_kb() {
+            std::ifstream smaps("/proc/self/smaps_rollup");
+            std::string line;
+            while (std::getline(smaps, line)) {
+                if (line.rfind("AnonHugePages:", 0) == 0) {
+                    return std::atol(line.c_str() + 14);
+                }
+            }
+            return 0;
+        }
+
+        static long resident_kb() {
+            std::ifstream statm("/proc/self/statm");
+            long size = 0, resident = 0;
+            statm >> size >> resident;
+            return resident * (sysconf(_SC_PAGESIZE) >> 10);
+        }
+
+        static Usage now() {
+            rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            return Usage{usage.ru_minflt, usage.ru_majflt, anon_huge_kb()};
+        }
+    };
+
+} // namespace memory
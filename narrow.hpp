@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "types.hpp"
+
+/// Narrowed storage for Numeric and Date columns. Values are stored per
+/// block of BLOCK_ROWS rows as unsigned offsets from the block minimum, in
+/// the fewest bytes (1, 2, 4 or 8) that hold the block's range. The file
+/// <idx>.<type>.narrow.bin is a DataColumn<uint64_t> of
+///   rows, block rows, blocks,
+///   per block: base, data offset in words << 8 | width in bytes,
+///   block data, each padded to whole words.
+namespace narrow {
+
+    static constexpr uint64_t BLOCK_ROWS = 64 * 1024;
+    static constexpr uint64_t HEADER_WORDS = 3;
+    static constexpr uint64_t DIRECTORY_WORDS = 2;
+
+    template <typename T>
+    concept narrowable = requires { T::TAG; } && (T::TAG == types::NUMERIC || T::TAG == types::DATE);
+
+    template <typename T>
+    using raw_t = decltype(T::value);
+
+    /// Bytes needed for offsets up to `range`.
+    inline unsigned width_for(uint64_t range) {
+        return range <= 0xff ? 1 : range <= 0xffff ? 2 : range <= 0xffffffffull ? 4 : 8;
+    }
+
+    inline uint64_t block_words(uint64_t rows, unsigned width) {
+        return (rows * width + 7) / 8;
+    }
+
+    struct BlockInfo {
+        int64_t base;
+        unsigned width;
+    };
+
+    template <typename T>
+    BlockInfo analyze(const T* values, size_t count) {
+        auto [min, max] = std::minmax_element(values, values + count, [](const T& a, const T& b) { return a.value < b.value; });
+        int64_t base = count ? min->value : 0;
+        uint64_t range = count ? static_cast<uint64_t>(static_cast<int64_t>(max->value) - base) : 0;
+        return BlockInfo{base, width_for(range)};
+    }
+
+    template <typename U, typename T>
+    inline void pack(const T* values, size_t count, int64_t base, void* out) {
+        auto target = static_cast<U*>(out);
+        for (size_t i = 0; i != count; ++i) {
+            target[i] = static_cast<U>(static_cast<int64_t>(values[i].value) - base);
+        }
+    }
+
+    template <typename U, typename T>
+    inline void unpack(const void* in, size_t count, int64_t base, T* out) {
+        auto source = static_cast<const U*>(in);
+        for (size_t i = 0; i != count; ++i) {
+            out[i] = T(static_cast<raw_t<T>>(base + static_cast<int64_t>(source[i])));
+        }
+    }
+
+    /// Number of words of the narrowed file for `rows` values, the block
+    /// layout is returned in `blocks`.
+    template <typename T>
+    uint64_t layout(const T* values, size_t rows, std::vector<BlockInfo>& blocks) {
+        auto count = (rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        blocks.resize(count);
+        uint64_t words = HEADER_WORDS + count * DIRECTORY_WORDS;
+        for (auto block = 0ul; block != count; ++block) {
+            auto begin = block * BLOCK_ROWS, end = std::min<uint64_t>(rows, begin + BLOCK_ROWS);
+            blocks[block] = analyze(values + begin, end - begin);
+            words += block_words(end - begin, blocks[block].width);
+        }
+        return words;
+    }
+
+    /// Writes the narrowed image of `values` into `out`, which holds the
+    /// number of words returned by `layout`.
+    template <typename T>
+    void encode(const T* values, size_t rows, const std::vector<BlockInfo>& blocks, uint64_t* out) {
+        out[0] = rows;
+        out[1] = BLOCK_ROWS;
+        out[2] = blocks.size();
+        uint64_t* directory = out + HEADER_WORDS;
+        uint64_t* data = directory + blocks.size() * DIRECTORY_WORDS;
+        uint64_t offset = 0;
+        for (auto block = 0ul; block != blocks.size(); ++block) {
+            auto begin = block * BLOCK_ROWS, count = std::min<uint64_t>(rows - begin, BLOCK_ROWS);
+            auto [base, width] = blocks[block];
+            directory[block * DIRECTORY_WORDS] = static_cast<uint64_t>(base);
+            directory[block * DIRECTORY_WORDS + 1] = offset << 8 | width;
+            auto target = data + offset;
+            switch (width) {
+                case 1: pack<uint8_t>(values + begin, count, base, target); break;
+                case 2: pack<uint16_t>(values + begin, count, base, target); break;
+                case 4: pack<uint32_t>(values + begin, count, base, target); break;
+                default: pack<uint64_t>(values + begin, count, base, target); break;
+            }
+            offset += block_words(count, width);
+        }
+    }
+
+} // namespace narrow
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "narrow.hpp"
+
+/// Staged conversion. Instead of parsing a whole table into memory and
+/// writing it afterwards, batches of BATCH_ROWS input lines flow through
+///
+///   read -> parse -> encode -> write
+///
+/// connected by bounded queues. The read stage finds the line boundaries of
+/// the next batch, which faults in the input, parse threads fill the
+/// columns of a batch, encode threads turn them into their on-disk layout
+/// and write threads store them at offsets assigned in input order. A fixed
+/// pool of batches is recycled through the stages, so a slow stage stalls
+/// the read stage instead of buffering the input in memory. Layouts that
+/// need the whole column (narrow blocks, Bloom filters, string slots,
+/// validity files) are still collected and written at the end.
+namespace pipeline {
+
+    static constexpr size_t BATCH_ROWS = narrow::BLOCK_ROWS;
+
+    struct Options {
+        bool enabled = false;
+        // threads per stage, 0 uses the THREADS setting
+        unsigned parse = 0;
+        unsigned encode = 1;
+        unsigned write = 1;
+        // batches in flight, 0 for two per parse thread and one per other stage
+        unsigned batches = 0;
+
+        inline unsigned parse_threads(unsigned threads) const { return parse ? parse : threads; }
+        inline unsigned batch_count(unsigned threads) const {
+            return batches ? batches : 2 * parse_threads(threads) + encode + write;
+        }
+    };
+
+    /// Parses "1" or a list like "parse=6,encode=2,write=2,batches=16".
+    inline Options parse_options(std::string_view spec) {
+        Options result;
+        result.enabled = spec != "0" && !spec.empty();
+        while (!spec.empty()) {
+            auto end = std::min(spec.find(','), spec.size());
+            auto entry = spec.substr(0, end);
+            auto eq = entry.find('=');
+            if (eq != std::string_view::npos) {
+                auto name = entry.substr(0, eq);
+                auto value = static_cast<unsigned>(atoi(std::string(entry.substr(eq + 1)).c_str()));
+                if (name == "parse") {
+                    result.parse = value;
+                } else if (name == "encode") {
+                    result.encode = std::max(1u, value);
+                } else if (name == "write") {
+                    result.write = std::max(1u, value);
+                } else if (name == "batches") {
+                    result.batches = value;
+                } else {
+                    throw "unknown PIPELINE stage";
+                }
+            }
+            spec.remove_prefix(std::min(end + 1, spec.size()));
+        }
+        return result;
+    }
+
+    /// Bounded multi-producer multi-consumer queue. Producers and consumers
+    /// take a ticket with one atomic increment and wait on their slot only,
+    /// threads block in push() while the queue is full and in pop() while
+    /// it is empty.
+    template <typename T>
+    class Queue {
+        struct alignas(64) Slot {
+            // ticket of the next push to this slot, or of the pop + 1
+            std::atomic<size_t> turn;
+            T value;
+        };
+
+        std::vector<Slot> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> tail = 0;
+        alignas(64) std::atomic<size_t> head = 0;
+
+        static inline void wait_for(std::atomic<size_t>& turn, size_t ticket) {
+            for (auto current = turn.load(std::memory_order_acquire); current != ticket;
+                 current = turn.load(std::memory_order_acquire)) {
+                turn.wait(current, std::memory_order_acquire);
+            }
+        }
+
+    public:
+        explicit Queue(size_t capacity) : slots(std::bit_ceil(std::max<size_t>(capacity, 2))), mask(slots.size() - 1) {
+            for (auto i = 0ul; i != slots.size(); ++i) {
+                slots[i].turn.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        void push(T value) {
+            auto ticket = tail.fetch_add(1, std::memory_order_relaxed);
+            auto& slot = slots[ticket & mask];
+            wait_for(slot.turn, ticket);
+            slot.value = std::move(value);
+            slot.turn.store(ticket + 1, std::memory_order_release);
+            slot.turn.notify_all();
+        }
+
+        T pop() {
+            auto ticket = head.fetch_add(1, std::memory_order_relaxed);
+            auto& slot = slots[ticket & mask];
+            wait_for(slot.turn, ticket + 1);
+            T value = std::move(slot.value);
+            slot.turn.store(ticket + slots.size(), std::memory_order_release);
+            slot.turn.notify_all();
+            return value;
+        }
+    };
+
+    /// A column file written in pieces at known offsets. finish writes the
+    /// io::DataColumn header built by column_header in common.hpp.
+    class StreamFile {
+        std::string path;
+        int fd;
+
+    public:
+        explicit StreamFile(std::string file) : path(std::move(file)) {
+            fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                throw "cannot create column file";
+            }
+        }
+
+        StreamFile(const StreamFile&) = delete;
+
+        ~StreamFile() {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        /// Returns 0 or the errno of the failed write.
+        int write(const void* data, size_t bytes, uint64_t offset) {
+            auto in = static_cast<const char*>(data);
+            while (bytes) {
+                auto done = pwrite(fd, in, bytes, offset);
+                if (done < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return errno;
+                }
+                in += done;
+                bytes -= done;
+                offset += done;
+            }
+            return 0;
+        }
+
+        /// Writes `header` and sizes the file, returns 0 or the errno.
+        int finish(const std::string& header, size_t size) {
+            if (auto error = write(header.data(), header.size(), 0)) {
+                return error;
+            }
+            if (ftruncate(fd, size)) {
+                return errno;
+            }
+            close(fd);
+            fd = -1;
+            return 0;
+        }
+
+        /// Removes the file after a failed conversion.
+        void discard() {
+            close(fd);
+            fd = -1;
+            std::filesystem::remove(path);
+        }
+    };
+
+} // namespace pipeline
@@ -0,0 +1,1429 @@
+#include "csv-read/csv.hpp"
+#include "common.hpp"
+#include "tpch.hpp"
+#include "like.hpp"
+#include "aggregate.hpp"
+#include "decimal.hpp"
+#include "scan.hpp"
+#include "container.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+
+// Runs the 22 TPC-H queries as hand-written, multi-threaded plans over the
+// converted columns, reports their runtimes and checks their result counts.
+// INPUT: directory containing the per-table column directories (e.g. output/)
+// QUERIES: comma-separated subset to run, e.g. "1,6,14", all by default
+// SF: scale factor of the data, inferred from orders if unset; result counts
+//     are only checked at SF 1, the scale all-count.sql was run at
+// PRINT=1: print the result rows
+// Columns are read in the layouts all.out writes: plain, NARROW=1, STRINGS=inline
+// and plain columns packed with CONTAINER. Narrow and inline columns are decoded
+// into memory when the tables are opened. Delta segments and deletions are ignored.
+
+using namespace tpch;
+
+// result counts of all-count.sql at SF 1, by query number
+constexpr size_t SF1_COUNTS[23] = {0, 4, 100, 10, 5, 5, 1, 4, 2, 175, 20, 1048, 2, 42, 1, 1, 18314, 1, 57, 1, 186, 100, 7};
+static constexpr size_t MORSEL_ROWS = 16 * 1024;
+static constexpr uint32_t NONE = ~0u;
+
+using Revenue = Numeric<12, 4>;
+using Result = std::vector<std::string>;
+static const Decimal ONE = Decimal::buildRaw(100);
+
+/// Where a column of a converted table is stored.
+struct ColumnLocation {
+    std::string file;
+    // the table's container, if it has one
+    const container::Table* packed;
+    unsigned idx;
+};
+
+/// A column in the layout it was written in, detected like
+/// verify::checksum_column does. Plain column files and container sections
+/// are mapped, narrow and inline columns are decoded once, so the plans see
+/// contiguous values in every layout.
+template <typename T>
+struct StoredColumn {
+    using value_t = T;
+    using page_t = io::DataColumn<T>;
+
+    std::optional<ColumnInput<T>> mapped;
+    std::vector<T> decoded;
+    const T* values = nullptr;
+    size_t rows = 0;
+
+    // constructed in place, `values` may point into `mapped`
+    StoredColumn(const StoredColumn&) = delete;
+
+    StoredColumn(const ColumnLocation& location) {
+        auto& [file, packed, idx] = location;
+        if constexpr (narrow::narrowable<T>) {
+            if (std::filesystem::exists(column_sibling(file, "narrow"))) {
+                NarrowColumnInput<T> input(file);
+                decoded.resize(input.size());
+                for (size_t block = 0; block * narrow::BLOCK_ROWS < input.size(); ++block) {
+                    input.decode_block(block, decoded.data() + block * narrow::BLOCK_ROWS);
+                }
+                values = decoded.data();
+                rows = decoded.size();
+                return;
+            }
+        }
+        if constexpr (inline_string_column<T> && !page_t::size_tag::IS_VARIABLE) {
+            if (std::filesystem::exists(column_sibling(file, "inline"))) {
+                InlineStringInput input(file);
+                decoded.resize(input.size());
+                for (size_t row = 0; row != input.size(); ++row) {
+                    auto str = input.view(row);
+                    decoded[row] = T::castString(str.data(), str.size());
+                }
+                values = decoded.data();
+                rows = decoded.size();
+                return;
+            }
+        }
+        if (std::filesystem::exists(file) || !packed) {
+            mapped.emplace(file.c_str());
+            rows = mapped->size();
+            if constexpr (!page_t::size_tag::IS_VARIABLE) {
+                values = &(*mapped)[0];
+            }
+            return;
+        }
+        if constexpr (!page_t::size_tag::IS_VARIABLE) {
+            if (packed->find(idx)) {
+                auto section = packed->template values<T>(idx);
+                values = section.data();
+                rows = section.size();
+                return;
+            }
+        }
+        throw "column layout not supported in a container, convert with CONTAINER=1 to keep the column files";
+    }
+
+    inline size_t size() const { return rows; }
+
+    inline decltype(auto) operator[](size_t idx) const {
+        if constexpr (page_t::size_tag::IS_VARIABLE) {
+            return (*mapped)[idx];
+        } else {
+            return static_cast<const T&>(values[idx]);
+        }
+    }
+};
+
+/// A nullable column and its validity, from the valid file or the container.
+template <typename T>
+struct StoredColumn<types::Nullable<T>> : StoredColumn<T>, ValidityInput<T> {
+    using value_t = types::Nullable<T>;
+
+    StoredColumn(const ColumnLocation& location) : StoredColumn<T>(location), ValidityInput<T>(location.file) {
+        auto& [file, packed, idx] = location;
+        using output_t = typename ValidityInput<T>::output_t;
+        if (!this->validity && packed && packed->find(idx, "valid")) {
+            auto words = packed->template values<uint64_t>(idx, "valid");
+            this->directory = words.data() + output_t::HEADER_WORDS;
+            this->bitmaps = this->directory + words[2];
+        }
+    }
+
+    inline value_t operator[](size_t idx) const {
+        if (this->is_null(idx)) {
+            return value_t::makeNull();
+        }
+        return value_t(StoredColumn<T>::operator[](idx));
+    }
+};
+
+/// The columns of a converted table.
+template <typename Def>
+struct TableColumns {
+    using columns_t = typename Def::columns;
+    using inputs_t = typename Def::template map_columns<StoredColumn>;
+
+    // only read for columns without a column file, see CONTAINER=only
+    std::optional<container::Table> packed;
+    inputs_t inputs;
+
+    TableColumns(const std::string& dir)
+        : packed(open_container(dir))
+        , inputs(locate(dir, packed ? &*packed : nullptr, std::make_index_sequence<std::tuple_size_v<columns_t>>{})) {}
+
+    inline size_t rows() const { return std::get<0>(inputs).size(); }
+
+private:
+    static std::optional<container::Table> open_container(const std::string& dir) {
+        std::optional<container::Table> result;
+        if (std::filesystem::exists(dir + container::FILE_NAME)) {
+            result.emplace(dir);
+        }
+        return result;
+    }
+
+    // the columns are constructed in place from the locations
+    template <size_t... Is>
+    static auto locate(const std::string& dir, const container::Table* packed, std::index_sequence<Is...>) {
+        return std::make_tuple(ColumnLocation{column_file<std::tuple_element_t<Is, columns_t>>(dir, Is), packed, Is}...);
+    }
+};
+
+struct Database {
+    std::tuple<TableColumns<nation>, TableColumns<region>, TableColumns<supplier>, TableColumns<customer>,
+               TableColumns<part>, TableColumns<partsupp>, TableColumns<orders>, TableColumns<lineitem>> tables;
+    unsigned threads;
+
+    Database(const std::string& dir, unsigned threads)
+      : tables(dir + "nation/", dir + "region/", dir + "supplier/", dir + "customer/", dir + "part/",
+               dir + "partsupp/", dir + "orders/", dir + "lineitem/")
+      , threads(threads) {}
+
+    template <typename Def>
+    inline const TableColumns<Def>& table() const { return std::get<TableColumns<Def>>(tables); }
+    template <typename Def, size_t I>
+    inline const auto& col() const { return std::get<I>(table<Def>().inputs); }
+    template <typename Def>
+    inline size_t rows() const { return table<Def>().rows(); }
+};
+
+// calls fn(worker, begin, end) for the morsels of [0, rows) on all workers
+template <typename F>
+void parallel_for(const Database& db, size_t rows, const F& fn) {
+    std::atomic<size_t> next = 0;
+    run_workers(db.threads, [&](unsigned worker) {
+      for (size_t begin; (begin = next.fetch_add(MORSEL_ROWS)) < rows;) {
+        fn(worker, begin, std::min(rows, begin + MORSEL_ROWS));
+      }
+    });
+}
+
+inline Date date(const char* str) {
+    return Date::castString(str, strlen(str));
+}
+
+inline int year(const Date& d) {
+    return Date::extractYear(d).value;
+}
+
+template <typename S>
+inline std::string_view view(const S& str) {
+    return std::string_view(str.value, str.len);
+}
+
+template <typename T>
+int64_t max_key(const StoredColumn<T>& keys) {
+    int64_t max = 0;
+    for (size_t row = 0; row != keys.size(); ++row) {
+      max = std::max<int64_t>(max, keys[row].value);
+    }
+    return max;
+}
+
+// row of every key of a key column, NONE for keys that do not occur
+template <typename T>
+std::vector<uint32_t> key_index(const StoredColumn<T>& keys) {
+    std::vector<uint32_t> index(max_key(keys) + 1, NONE);
+    for (size_t row = 0; row != keys.size(); ++row) {
+      index[keys[row].value] = row;
+    }
+    return index;
+}
+
+// rows of a string column matching a LIKE pattern
+template <typename T>
+like::bitmap_t like_bitmap(const StoredColumn<T>& column, std::string_view pattern, unsigned threads) {
+    return like::evaluate(like::SlotStrings<T>(column.values, column.size()), pattern, threads);
+}
+
+int32_t nation_key(const Database& db, std::string_view name) {
+    auto& names = db.col<nation, n_name>();
+    for (size_t row = 0; row != names.size(); ++row) {
+      if (view(names[row]) == name) {
+        return db.col<nation, n_nationkey>()[row].value;
+      }
+    }
+    throw "unknown nation";
+}
+
+// by nation key, set for the nations of the region
+std::vector<uint8_t> nations_in_region(const Database& db, std::string_view name) {
+    int32_t region_key = -1;
+    for (size_t row = 0; row != db.rows<region>(); ++row) {
+      if (view(db.col<region, r_name>()[row]) == name) {
+        region_key = db.col<region, r_regionkey>()[row].value;
+      }
+    }
+    auto& keys = db.col<nation, n_nationkey>();
+    std::vector<uint8_t> result(max_key(keys) + 1);
+    for (size_t row = 0; row != keys.size(); ++row) {
+      result[keys[row].value] = db.col<nation, n_regionkey>()[row].value == region_key;
+    }
+    return result;
+}
+
+std::string_view nation_name(const Database& db, int32_t key) {
+    auto& keys = db.col<nation, n_nationkey>();
+    for (size_t row = 0; row != keys.size(); ++row) {
+      if (keys[row].value == key) {
+        return view(db.col<nation, n_name>()[row]);
+      }
+    }
+    throw "unknown nation key";
+}
+
+// by supplier key, the nation of the supplier
+std::vector<int8_t> supplier_nations(const Database& db) {
+    auto& keys = db.col<supplier, s_suppkey>();
+    std::vector<int8_t> result(max_key(keys) + 1, -1);
+    for (size_t row = 0; row != keys.size(); ++row) {
+      result[keys[row].value] = db.col<supplier, s_nationkey>()[row].value;
+    }
+    return result;
+}
+
+// by customer key, the nation of the customer
+std::vector<int8_t> customer_nations(const Database& db) {
+    auto& keys = db.col<customer, c_custkey>();
+    std::vector<int8_t> result(max_key(keys) + 1, -1);
+    for (size_t row = 0; row != keys.size(); ++row) {
+      result[keys[row].value] = db.col<customer, c_nationkey>()[row].value;
+    }
+    return result;
+}
+
+// by part key, set for the parts whose row is set in `rows`
+template <typename F>
+std::vector<uint8_t> part_flags(const Database& db, const F& selected) {
+    auto& keys = db.col<part, p_partkey>();
+    std::vector<uint8_t> result(max_key(keys) + 1);
+    for (size_t row = 0; row != keys.size(); ++row) {
+      result[keys[row].value] = selected(row);
+    }
+    return result;
+}
+
+/// A sum of Numeric values that may exceed 64 bits, e.g. sum_charge of Q1
+/// beyond SF 100.
+template <unsigned scale>
+struct WideSum {
+    __int128 value = 0;
+
+    template <unsigned len>
+    inline void operator+=(const Numeric<len, scale>& x) { value += x.value; }
+    inline void operator+=(const WideSum& other) { value += other.value; }
+};
+
+template <unsigned scale>
+std::string text(const WideSum<scale>& sum) {
+    auto magnitude = static_cast<unsigned __int128>(sum.value < 0 ? -sum.value : sum.value);
+    std::string digits;
+    for (; magnitude || digits.size() <= scale; magnitude /= 10) {
+      digits.push_back('0' + static_cast<char>(magnitude % 10));
+    }
+    digits.insert(scale, 1, '.');
+    if (sum.value < 0) {
+      digits.push_back('-');
+    }
+    return std::string(digits.rbegin(), digits.rend());
+}
+
+template <typename T>
+std::string text(const T& value) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      return std::to_string(value);
+    } else if constexpr (std::is_convertible_v<T, std::string_view>) {
+      return std::string(value);
+    } else {
+      char buffer[io::csv::Formatter<T>::MAX_WIDTH + 1];
+      return std::string(buffer, io::csv::Formatter<T>::format(buffer, value));
+    }
+}
+
+template <typename... Vs>
+std::string row(const Vs&... values) {
+    std::string result;
+    ((result += text(values), result += '|'), ...);
+    result.pop_back();
+    return result;
+}
+
+// sums the per-worker values of `locals` into the first one
+template <typename T>
+T& merge_into_first(std::vector<T>& locals) {
+    for (auto w = 1u; w < locals.size(); ++w) {
+      for (auto& [key, value] : locals[w]) {
+        locals[0][key] += value;
+      }
+    }
+    return locals[0];
+}
+
+Result q1(const Database& db) {
+    auto& shipdate = db.col<lineitem, l_shipdate>();
+    auto& quantity = db.col<lineitem, l_quantity>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    auto& tax = db.col<lineitem, l_tax>();
+    auto& returnflag = db.col<lineitem, l_returnflag>();
+    auto& linestatus = db.col<lineitem, l_linestatus>();
+    auto limit = date("1998-09-02");
+    struct State {
+      Decimal qty, price, disc;
+      Revenue disc_price;
+      WideSum<6> charge;
+      size_t count = 0;
+
+      inline void merge(const State& other) {
+        qty += other.qty;
+        price += other.price;
+        disc += other.disc;
+        disc_price += other.disc_price;
+        charge += other.charge;
+        count += other.count;
+      }
+    };
+    using Key = std::tuple<Char<1>, Char<1>>;
+    struct Buffers {
+      std::vector<Revenue> disc_price = std::vector<Revenue>(MORSEL_ROWS);
+      std::vector<Numeric<12, 6>> charge = std::vector<Numeric<12, 6>>(MORSEL_ROWS);
+    };
+    std::vector<Buffers> buffers(db.threads);
+    aggregate::Aggregation<Key, State> aggregation(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      using namespace decimal;
+      auto& groups = aggregation.local(w);
+      auto& b = buffers[w];
+      evaluate(column(&price[begin]) * (constant(ONE) - column(&discount[begin])), b.disc_price.data(), end - begin);
+      evaluate(column(b.disc_price.data()) * (constant(ONE) + column(&tax[begin])), b.charge.data(), end - begin);
+      for (auto i = begin; i != end; ++i) {
+        if (shipdate[i] > limit) {
+          continue;
+        }
+        auto& group = groups[{returnflag[i], linestatus[i]}];
+        group.qty += quantity[i];
+        group.price += price[i];
+        group.disc += discount[i];
+        group.disc_price += b.disc_price[i - begin];
+        group.charge += b.charge[i - begin];
+        ++group.count;
+      }
+    });
+    auto groups = aggregation.merge();
+    std::sort(groups.begin(), groups.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    Result result;
+    for (auto& [key, g] : groups) {
+      double count = g.count;
+      result.push_back(row(std::get<0>(key), std::get<1>(key), g.qty, g.price, g.disc_price,
+                           g.charge, g.qty.value / 100.0 / count, g.price.value / 100.0 / count,
+                           g.disc.value / 100.0 / count, g.count));
+    }
+    return result;
+}
+
+Result q2(const Database& db) {
+    auto europe = nations_in_region(db, "EUROPE");
+    auto supp_nation = supplier_nations(db);
+    auto brass = like_bitmap(db.col<part, p_type>(), "%BRASS", db.threads);
+    auto selected = part_flags(db, [&](size_t row) {
+      return db.col<part, p_size>()[row].value == 15 && like::test(brass, row);
+    });
+    struct Offer {
+      int32_t part, supp;
+      Decimal cost;
+    };
+    std::vector<std::vector<Offer>> locals(db.threads);
+    auto& ps_part = db.col<partsupp, ps_partkey>();
+    auto& ps_supp = db.col<partsupp, ps_suppkey>();
+    auto& cost = db.col<partsupp, ps_supplycost>();
+    parallel_for(db, db.rows<partsupp>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (selected[ps_part[i].value] && europe[supp_nation[ps_supp[i].value]]) {
+          locals[w].push_back(Offer{ps_part[i].value, ps_supp[i].value, cost[i]});
+        }
+      }
+    });
+    std::unordered_map<int32_t, Decimal> min_cost;
+    for (auto& local : locals) {
+      for (auto& offer : local) {
+        auto [it, inserted] = min_cost.try_emplace(offer.part, offer.cost);
+        if (!inserted && offer.cost < it->second) {
+          it->second = offer.cost;
+        }
+      }
+    }
+    auto supp_row = key_index(db.col<supplier, s_suppkey>());
+    auto part_row = key_index(db.col<part, p_partkey>());
+    struct Out {
+      Decimal acctbal;
+      std::string_view supp_name, nation;
+      int32_t part;
+      uint32_t supp_row, part_row;
+    };
+    std::vector<Out> out;
+    for (auto& local : locals) {
+      for (auto& offer : local) {
+        if (offer.cost == min_cost[offer.part]) {
+          auto s = supp_row[offer.supp];
+          out.push_back(Out{db.col<supplier, s_acctbal>()[s], view(db.col<supplier, s_name>()[s]),
+                            nation_name(db, supp_nation[offer.supp]), offer.part, s, part_row[offer.part]});
+        }
+      }
+    }
+    std::sort(out.begin(), out.end(), [](const Out& a, const Out& b) {
+      return std::tie(b.acctbal, a.nation, a.supp_name, a.part) < std::tie(a.acctbal, b.nation, b.supp_name, b.part);
+    });
+    Result result;
+    for (auto& o : out) {
+      if (result.size() == 100) {
+        break;
+      }
+      result.push_back(row(o.acctbal, o.supp_name, o.nation, o.part, db.col<part, p_mfgr>()[o.part_row],
+                           db.col<supplier, s_address>()[o.supp_row], db.col<supplier, s_phone>()[o.supp_row],
+                           db.col<supplier, s_comment>()[o.supp_row]));
+    }
+    return result;
+}
+
+Result q3(const Database& db) {
+    auto& custkey = db.col<customer, c_custkey>();
+    std::vector<uint8_t> building(max_key(custkey) + 1);
+    for (size_t i = 0; i != custkey.size(); ++i) {
+      building[custkey[i].value] = view(db.col<customer, c_mktsegment>()[i]) == "BUILDING";
+    }
+    auto cutoff = date("1995-03-15");
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& o_cust = db.col<orders, o_custkey>();
+    auto& orderdate = db.col<orders, o_orderdate>();
+    std::vector<uint32_t> order_row(max_key(orderkey) + 1, NONE);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (orderdate[i] < cutoff && building[o_cust[i].value]) {
+          order_row[orderkey[i].value] = i;
+        }
+      }
+    });
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& shipdate = db.col<lineitem, l_shipdate>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    aggregate::Aggregation<int64_t, Revenue> revenue(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      auto& groups = revenue.local(w);
+      for (auto i = begin; i != end; ++i) {
+        if (shipdate[i] > cutoff && order_row[l_order[i].value] != NONE) {
+          groups[l_order[i].value] += price[i] * (ONE - discount[i]);
+        }
+      }
+    });
+    auto out = revenue.merge();
+    auto top = std::min<size_t>(10, out.size());
+    std::partial_sort(out.begin(), out.begin() + top, out.end(), [&](const auto& a, const auto& b) {
+      return std::make_tuple(b.second, orderdate[order_row[a.first]]) < std::make_tuple(a.second, orderdate[order_row[b.first]]);
+    });
+    Result result;
+    for (auto i = 0ul; i != top; ++i) {
+      auto o = order_row[out[i].first];
+      result.push_back(row(out[i].first, out[i].second, orderdate[o], db.col<orders, o_shippriority>()[o]));
+    }
+    return result;
+}
+
+Result q4(const Database& db) {
+    auto& orderkey = db.col<orders, o_orderkey>();
+    std::vector<uint8_t> late(max_key(orderkey) + 1);
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& commitdate = db.col<lineitem, l_commitdate>();
+    auto& receiptdate = db.col<lineitem, l_receiptdate>();
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (commitdate[i] < receiptdate[i]) {
+          __atomic_store_n(&late[l_order[i].value], 1, __ATOMIC_RELAXED);
+        }
+      }
+    });
+    auto from = date("1993-07-01"), to = date("1993-10-01");
+    auto& orderdate = db.col<orders, o_orderdate>();
+    auto& priority = db.col<orders, o_orderpriority>();
+    std::vector<std::map<std::string_view, size_t>> locals(db.threads);
+    parallel_for(db, db.rows<orders>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (orderdate[i] >= from && orderdate[i] < to && late[orderkey[i].value]) {
+          ++locals[w][view(priority[i])];
+        }
+      }
+    });
+    Result result;
+    for (auto& [name, count] : merge_into_first(locals)) {
+      result.push_back(row(name, count));
+    }
+    return result;
+}
+
+Result q5(const Database& db) {
+    auto asia = nations_in_region(db, "ASIA");
+    auto cust_nation = customer_nations(db);
+    auto supp_nation = supplier_nations(db);
+    auto from = date("1994-01-01"), to = date("1995-01-01");
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& o_cust = db.col<orders, o_custkey>();
+    auto& orderdate = db.col<orders, o_orderdate>();
+    std::vector<int8_t> order_nation(max_key(orderkey) + 1, -1);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto nation = cust_nation[o_cust[i].value];
+        if (orderdate[i] >= from && orderdate[i] < to && asia[nation]) {
+          order_nation[orderkey[i].value] = nation;
+        }
+      }
+    });
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& l_supp = db.col<lineitem, l_suppkey>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    std::vector<std::map<int, Revenue>> locals(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto nation = order_nation[l_order[i].value];
+        if (nation >= 0 && supp_nation[l_supp[i].value] == nation) {
+          locals[w][nation] += price[i] * (ONE - discount[i]);
+        }
+      }
+    });
+    std::vector<std::pair<int, Revenue>> out;
+    for (auto& entry : merge_into_first(locals)) {
+      out.push_back(entry);
+    }
+    std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return b.second < a.second; });
+    Result result;
+    for (auto& [nation, revenue] : out) {
+      result.push_back(row(nation_name(db, nation), revenue));
+    }
+    return result;
+}
+
+Result q6(const Database& db) {
+    auto& shipdate = db.col<lineitem, l_shipdate>();
+    auto& quantity = db.col<lineitem, l_quantity>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    auto from = date("1994-01-01"), to = date("1995-01-01");
+    auto low = Decimal::buildRaw(5), high = Decimal::buildRaw(7), max_quantity = Decimal::buildRaw(2400);
+    std::vector<Revenue> locals(db.threads);
+    std::vector<std::vector<uint32_t>> selections(db.threads, std::vector<uint32_t>(MORSEL_ROWS));
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      // only the rows selected so far are read from the next column
+      auto sel = selections[w].data();
+      auto count = scan::select(shipdate, begin, end, [&](const Date& d) { return d >= from && d < to; }, sel);
+      count = scan::refine(discount, sel, count, [&](const Decimal& d) { return d >= low && d <= high; }, sel);
+      count = scan::refine(quantity, sel, count, [&](const Decimal& q) { return q < max_quantity; }, sel);
+      Revenue sum;
+      for (size_t i = 0; i != count; ++i) {
+        sum += price[sel[i]] * discount[sel[i]];
+      }
+      locals[w] += sum;
+    });
+    Revenue revenue;
+    for (auto& local : locals) {
+      revenue += local;
+    }
+    return {row(revenue)};
+}
+
+Result q7(const Database& db) {
+    int32_t nations[2] = {nation_key(db, "FRANCE"), nation_key(db, "GERMANY")};
+    auto cust_nation = customer_nations(db);
+    auto supp_nation = supplier_nations(db);
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& o_cust = db.col<orders, o_custkey>();
+    std::vector<int8_t> order_nation(max_key(orderkey) + 1, -1);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        order_nation[orderkey[i].value] = cust_nation[o_cust[i].value];
+      }
+    });
+    auto from = date("1995-01-01"), to = date("1996-12-31");
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& l_supp = db.col<lineitem, l_suppkey>();
+    auto& shipdate = db.col<lineitem, l_shipdate>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    // [supplier nation is France][year - 1995]
+    using Sums = std::array<std::array<Revenue, 2>, 2>;
+    std::vector<Sums> locals(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (shipdate[i] < from || shipdate[i] > to) {
+          continue;
+        }
+        auto supp = supp_nation[l_supp[i].value], cust = order_nation[l_order[i].value];
+        if ((supp == nations[0] && cust == nations[1]) || (supp == nations[1] && cust == nations[0])) {
+          locals[w][supp == nations[0] ? 0 : 1][year(shipdate[i]) - 1995] += price[i] * (ONE - discount[i]);
+        }
+      }
+    });
+    Sums sums{};
+    for (auto& local : locals) {
+      for (auto s = 0; s != 2; ++s) {
+        for (auto y = 0; y != 2; ++y) {
+          sums[s][y] += local[s][y];
+        }
+      }
+    }
+    Result result;
+    // FRANCE sorts before GERMANY
+    for (auto s = 0; s != 2; ++s) {
+      for (auto y = 0; y != 2; ++y) {
+        if (sums[s][y].value) {
+          result.push_back(row(nation_name(db, nations[s]), nation_name(db, nations[1 - s]), 1995 + y, sums[s][y]));
+        }
+      }
+    }
+    return result;
+}
+
+Result q8(const Database& db) {
+    auto america = nations_in_region(db, "AMERICA");
+    auto brazil = nation_key(db, "BRAZIL");
+    auto cust_nation = customer_nations(db);
+    auto supp_nation = supplier_nations(db);
+    auto selected = part_flags(db, [&](size_t row) { return view(db.col<part, p_type>()[row]) == "ECONOMY ANODIZED STEEL"; });
+    auto from = date("1995-01-01"), to = date("1996-12-31");
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& o_cust = db.col<orders, o_custkey>();
+    auto& orderdate = db.col<orders, o_orderdate>();
+    std::vector<int16_t> order_year(max_key(orderkey) + 1);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (orderdate[i] >= from && orderdate[i] <= to && america[cust_nation[o_cust[i].value]]) {
+          order_year[orderkey[i].value] = year(orderdate[i]);
+        }
+      }
+    });
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& l_part = db.col<lineitem, l_partkey>();
+    auto& l_supp = db.col<lineitem, l_suppkey>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    // per year - 1995: all volume and Brazil's volume
+    using Sums = std::array<std::array<Revenue, 2>, 2>;
+    std::vector<Sums> locals(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto y = order_year[l_order[i].value];
+        if (y && selected[l_part[i].value]) {
+          auto volume = price[i] * (ONE - discount[i]);
+          locals[w][y - 1995][0] += volume;
+          if (supp_nation[l_supp[i].value] == brazil) {
+            locals[w][y - 1995][1] += volume;
+          }
+        }
+      }
+    });
+    Sums sums{};
+    for (auto& local : locals) {
+      for (auto y = 0; y != 2; ++y) {
+        sums[y][0] += local[y][0];
+        sums[y][1] += local[y][1];
+      }
+    }
+    Result result;
+    for (auto y = 0; y != 2; ++y) {
+      if (sums[y][0].value) {
+        result.push_back(row(1995 + y, static_cast<double>(sums[y][1].value) / sums[y][0].value));
+      }
+    }
+    return result;
+}
+
+Result q9(const Database& db) {
+    auto green = like_bitmap(db.col<part, p_name>(), "%green%", db.threads);
+    auto selected = part_flags(db, [&](size_t row) { return like::test(green, row); });
+    auto supp_nation = supplier_nations(db);
+    auto& ps_part = db.col<partsupp, ps_partkey>();
+    auto& ps_supp = db.col<partsupp, ps_suppkey>();
+    auto& supplycost = db.col<partsupp, ps_supplycost>();
+    auto pair_key = [](int64_t part, int64_t supp) { return static_cast<uint64_t>(part) << 32 | supp; };
+    std::unordered_map<uint64_t, Decimal> cost;
+    for (size_t i = 0; i != ps_part.size(); ++i) {
+      if (selected[ps_part[i].value]) {
+        cost[pair_key(ps_part[i].value, ps_supp[i].value)] = supplycost[i];
+      }
+    }
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& orderdate = db.col<orders, o_orderdate>();
+    std::vector<int16_t> order_year(max_key(orderkey) + 1);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        order_year[orderkey[i].value] = year(orderdate[i]);
+      }
+    });
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& l_part = db.col<lineitem, l_partkey>();
+    auto& l_supp = db.col<lineitem, l_suppkey>();
+    auto& quantity = db.col<lineitem, l_quantity>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    aggregate::Aggregation<std::pair<int, int>, Revenue> profits(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (!selected[l_part[i].value]) {
+          continue;
+        }
+        auto amount = price[i] * (ONE - discount[i]) - cost.at(pair_key(l_part[i].value, l_supp[i].value)) * quantity[i];
+        profits.local(w)[{supp_nation[l_supp[i].value], order_year[l_order[i].value]}] += amount;
+      }
+    });
+    struct Out {
+      std::string_view nation;
+      int year;
+      Revenue profit;
+    };
+    std::vector<Out> out;
+    for (auto& [key, profit] : profits.merge()) {
+      out.push_back(Out{nation_name(db, key.first), key.second, profit});
+    }
+    std::sort(out.begin(), out.end(), [](const Out& a, const Out& b) { return std::tie(a.nation, b.year) < std::tie(b.nation, a.year); });
+    Result result;
+    for (auto& o : out) {
+      result.push_back(row(o.nation, o.year, o.profit));
+    }
+    return result;
+}
+
+Result q10(const Database& db) {
+    auto from = date("1993-10-01"), to = date("1994-01-01");
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& o_cust = db.col<orders, o_custkey>();
+    auto& orderdate = db.col<orders, o_orderdate>();
+    std::vector<int32_t> order_cust(max_key(orderkey) + 1);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (orderdate[i] >= from && orderdate[i] < to) {
+          order_cust[orderkey[i].value] = o_cust[i].value;
+        }
+      }
+    });
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& returnflag = db.col<lineitem, l_returnflag>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    aggregate::Aggregation<int32_t, Revenue> revenue(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      auto& groups = revenue.local(w);
+      for (auto i = begin; i != end; ++i) {
+        auto cust = order_cust[l_order[i].value];
+        if (cust && returnflag[i].value == 'R') {
+          groups[cust] += price[i] * (ONE - discount[i]);
+        }
+      }
+    });
+    auto out = revenue.merge();
+    auto top = std::min<size_t>(20, out.size());
+    std::partial_sort(out.begin(), out.begin() + top, out.end(), [](const auto& a, const auto& b) { return b.second < a.second; });
+    auto cust_row = key_index(db.col<customer, c_custkey>());
+    Result result;
+    for (auto i = 0ul; i != top; ++i) {
+      auto c = cust_row[out[i].first];
+      result.push_back(row(out[i].first, db.col<customer, c_name>()[c], out[i].second, db.col<customer, c_acctbal>()[c],
+                           nation_name(db, db.col<customer, c_nationkey>()[c].value), db.col<customer, c_address>()[c],
+                           db.col<customer, c_phone>()[c], db.col<customer, c_comment>()[c]));
+    }
+    return result;
+}
+
+Result q11(const Database& db) {
+    auto germany = nation_key(db, "GERMANY");
+    auto supp_nation = supplier_nations(db);
+    auto& ps_part = db.col<partsupp, ps_partkey>();
+    auto& ps_supp = db.col<partsupp, ps_suppkey>();
+    auto& availqty = db.col<partsupp, ps_availqty>();
+    auto& supplycost = db.col<partsupp, ps_supplycost>();
+    // values in cents
+    aggregate::Aggregation<int32_t, int64_t> aggregation(db.threads);
+    parallel_for(db, db.rows<partsupp>(), [&](unsigned w, size_t begin, size_t end) {
+      auto& groups = aggregation.local(w);
+      for (auto i = begin; i != end; ++i) {
+        if (supp_nation[ps_supp[i].value] == germany) {
+          groups[ps_part[i].value] += supplycost[i].value * availqty[i].value;
+        }
+      }
+    });
+    auto values = aggregation.merge();
+    int64_t total = 0;
+    for (auto& [part, value] : values) {
+      total += value;
+    }
+    std::vector<std::pair<int32_t, int64_t>> out;
+    for (auto& entry : values) {
+      // value > total * 0.0001
+      if (entry.second * 10000 > total) {
+        out.push_back(entry);
+      }
+    }
+    std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return b.second < a.second; });
+    Result result;
+    for (auto& [part, value] : out) {
+      result.push_back(row(part, Decimal::buildRaw(value)));
+    }
+    return result;
+}
+
+Result q12(const Database& db) {
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& priority = db.col<orders, o_orderpriority>();
+    std::vector<uint8_t> high(max_key(orderkey) + 1);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto p = view(priority[i]);
+        high[orderkey[i].value] = p == "1-URGENT" || p == "2-HIGH";
+      }
+    });
+    auto from = date("1994-01-01"), to = date("1995-01-01");
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& shipmode = db.col<lineitem, l_shipmode>();
+    auto& shipdate = db.col<lineitem, l_shipdate>();
+    auto& commitdate = db.col<lineitem, l_commitdate>();
+    auto& receiptdate = db.col<lineitem, l_receiptdate>();
+    // [MAIL, SHIP][low, high]
+    using Counts = std::array<std::array<size_t, 2>, 2>;
+    std::vector<Counts> locals(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (receiptdate[i] < from || receiptdate[i] >= to || !(commitdate[i] < receiptdate[i]) || !(shipdate[i] < commitdate[i])) {
+          continue;
+        }
+        auto mode = view(shipmode[i]);
+        if (mode == "MAIL" || mode == "SHIP") {
+          ++locals[w][mode == "SHIP"][high[l_order[i].value]];
+        }
+      }
+    });
+    Result result;
+    const char* modes[] = {"MAIL", "SHIP"};
+    for (auto m = 0; m != 2; ++m) {
+      size_t low = 0, high = 0;
+      for (auto& local : locals) {
+        low += local[m][0];
+        high += local[m][1];
+      }
+      if (low + high) {
+        result.push_back(row(modes[m], high, low));
+      }
+    }
+    return result;
+}
+
+Result q13(const Database& db) {
+    auto special = like_bitmap(db.col<orders, o_comment>(), "%special%requests%", db.threads);
+    auto& custkey = db.col<customer, c_custkey>();
+    auto& o_cust = db.col<orders, o_custkey>();
+    std::vector<uint32_t> counts(std::max(max_key(custkey), max_key(o_cust)) + 1);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (!like::test(special, i)) {
+          __atomic_fetch_add(&counts[o_cust[i].value], 1, __ATOMIC_RELAXED);
+        }
+      }
+    });
+    std::map<uint32_t, size_t> custdist;
+    for (size_t i = 0; i != custkey.size(); ++i) {
+      ++custdist[counts[custkey[i].value]];
+    }
+    std::vector<std::pair<uint32_t, size_t>> out(custdist.begin(), custdist.end());
+    std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return std::tie(b.second, b.first) < std::tie(a.second, a.first); });
+    Result result;
+    for (auto& [count, customers] : out) {
+      result.push_back(row(count, customers));
+    }
+    return result;
+}
+
+Result q14(const Database& db) {
+    auto promo = like_bitmap(db.col<part, p_type>(), "PROMO%", db.threads);
+    auto selected = part_flags(db, [&](size_t row) { return like::test(promo, row); });
+    auto from = date("1995-09-01"), to = date("1995-10-01");
+    auto& l_part = db.col<lineitem, l_partkey>();
+    auto& shipdate = db.col<lineitem, l_shipdate>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    // [all, promo]
+    std::vector<std::array<Revenue, 2>> locals(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (shipdate[i] >= from && shipdate[i] < to) {
+          auto revenue = price[i] * (ONE - discount[i]);
+          locals[w][0] += revenue;
+          if (selected[l_part[i].value]) {
+            locals[w][1] += revenue;
+          }
+        }
+      }
+    });
+    Revenue all, promo_revenue;
+    for (auto& local : locals) {
+      all += local[0];
+      promo_revenue += local[1];
+    }
+    return {row(all.value ? 100.0 * promo_revenue.value / all.value : 0.0)};
+}
+
+Result q15(const Database& db) {
+    auto& suppkey = db.col<supplier, s_suppkey>();
+    auto& l_supp = db.col<lineitem, l_suppkey>();
+    auto& shipdate = db.col<lineitem, l_shipdate>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    auto from = date("1996-01-01"), to = date("1996-04-01");
+    auto keys = std::max(max_key(suppkey), max_key(l_supp)) + 1;
+    std::vector<std::vector<Revenue>> locals(db.threads, std::vector<Revenue>(keys));
+    std::vector<std::vector<uint8_t>> seen(db.threads, std::vector<uint8_t>(keys));
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (shipdate[i] >= from && shipdate[i] < to) {
+          locals[w][l_supp[i].value] += price[i] * (ONE - discount[i]);
+          seen[w][l_supp[i].value] = 1;
+        }
+      }
+    });
+    for (auto w = 1u; w < db.threads; ++w) {
+      for (int64_t key = 0; key != keys; ++key) {
+        locals[0][key] += locals[w][key];
+        seen[0][key] |= seen[w][key];
+      }
+    }
+    std::optional<Revenue> max;
+    for (int64_t key = 0; key != keys; ++key) {
+      if (seen[0][key] && (!max || *max < locals[0][key])) {
+        max = locals[0][key];
+      }
+    }
+    std::vector<std::pair<int32_t, uint32_t>> out;
+    for (size_t i = 0; i != suppkey.size(); ++i) {
+      auto key = suppkey[i].value;
+      if (seen[0][key] && locals[0][key] == *max) {
+        out.emplace_back(key, i);
+      }
+    }
+    std::sort(out.begin(), out.end());
+    Result result;
+    for (auto& [key, s] : out) {
+      result.push_back(row(key, db.col<supplier, s_name>()[s], db.col<supplier, s_address>()[s], db.col<supplier, s_phone>()[s], locals[0][key]));
+    }
+    return result;
+}
+
+Result q16(const Database& db) {
+    auto complaints = like_bitmap(db.col<supplier, s_comment>(), "%Customer%Complaints%", db.threads);
+    auto& suppkey = db.col<supplier, s_suppkey>();
+    std::vector<uint8_t> excluded(max_key(suppkey) + 1);
+    for (size_t i = 0; i != suppkey.size(); ++i) {
+      excluded[suppkey[i].value] = like::test(complaints, i);
+    }
+    auto polished = like_bitmap(db.col<part, p_type>(), "MEDIUM POLISHED%", db.threads);
+    auto& partkey = db.col<part, p_partkey>();
+    auto& brand = db.col<part, p_brand>();
+    auto& type = db.col<part, p_type>();
+    auto& size = db.col<part, p_size>();
+    // groups are numbered in the order of their first part
+    std::map<std::tuple<std::string_view, std::string_view, int32_t>, uint32_t> group_ids;
+    std::vector<uint32_t> first_part;
+    std::vector<uint32_t> part_group(max_key(partkey) + 1, NONE);
+    constexpr int32_t sizes[] = {49, 14, 23, 45, 19, 3, 36, 9};
+    for (size_t i = 0; i != partkey.size(); ++i) {
+      if (view(brand[i]) == "Brand#45" || like::test(polished, i) || std::find(std::begin(sizes), std::end(sizes), size[i].value) == std::end(sizes)) {
+        continue;
+      }
+      auto [it, inserted] = group_ids.try_emplace({view(brand[i]), view(type[i]), size[i].value}, first_part.size());
+      if (inserted) {
+        first_part.push_back(i);
+      }
+      part_group[partkey[i].value] = it->second;
+    }
+    auto& ps_part = db.col<partsupp, ps_partkey>();
+    auto& ps_supp = db.col<partsupp, ps_suppkey>();
+    std::vector<std::vector<uint64_t>> locals(db.threads);
+    parallel_for(db, db.rows<partsupp>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto group = part_group[ps_part[i].value];
+        if (group != NONE && !excluded[ps_supp[i].value]) {
+          locals[w].push_back(static_cast<uint64_t>(group) << 32 | ps_supp[i].value);
+        }
+      }
+    });
+    std::vector<uint64_t> pairs;
+    for (auto& local : locals) {
+      pairs.insert(pairs.end(), local.begin(), local.end());
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    std::vector<size_t> suppliers(first_part.size());
+    for (auto pair : pairs) {
+      ++suppliers[pair >> 32];
+    }
+    std::vector<std::pair<std::tuple<std::string_view, std::string_view, int32_t>, uint32_t>> out(group_ids.begin(), group_ids.end());
+    std::sort(out.begin(), out.end(), [&](const auto& a, const auto& b) {
+      return std::tie(suppliers[b.second], a.first) < std::tie(suppliers[a.second], b.first);
+    });
+    Result result;
+    for (auto& [key, group] : out) {
+      if (suppliers[group]) {
+        result.push_back(row(std::get<0>(key), std::get<1>(key), std::get<2>(key), suppliers[group]));
+      }
+    }
+    return result;
+}
+
+Result q17(const Database& db) {
+    auto& partkey = db.col<part, p_partkey>();
+    // slot of every selected part in the per-part sums
+    std::vector<uint32_t> slot(max_key(partkey) + 1, NONE);
+    uint32_t slots = 0;
+    for (size_t i = 0; i != partkey.size(); ++i) {
+      if (view(db.col<part, p_brand>()[i]) == "Brand#23" && view(db.col<part, p_container>()[i]) == "MED BOX") {
+        slot[partkey[i].value] = slots++;
+      }
+    }
+    auto& l_part = db.col<lineitem, l_partkey>();
+    auto& quantity = db.col<lineitem, l_quantity>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    // quantity sum and count per selected part
+    std::vector<std::vector<std::pair<int64_t, int64_t>>> locals(db.threads, std::vector<std::pair<int64_t, int64_t>>(slots));
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto s = slot[l_part[i].value];
+        if (s != NONE) {
+          locals[w][s].first += quantity[i].value;
+          ++locals[w][s].second;
+        }
+      }
+    });
+    for (auto w = 1u; w < db.threads; ++w) {
+      for (auto s = 0u; s != slots; ++s) {
+        locals[0][s].first += locals[w][s].first;
+        locals[0][s].second += locals[w][s].second;
+      }
+    }
+    auto& totals = locals[0];
+    std::vector<Decimal> sums(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto s = slot[l_part[i].value];
+        // quantity < 0.2 * avg(quantity)
+        if (s != NONE && quantity[i].value * totals[s].second * 5 < totals[s].first) {
+          sums[w] += price[i];
+        }
+      }
+    });
+    Decimal sum;
+    for (auto& local : sums) {
+      sum += local;
+    }
+    return {row(sum.value / 100.0 / 7.0)};
+}
+
+Result q18(const Database& db) {
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto& quantity = db.col<lineitem, l_quantity>();
+    // quantities in cents
+    std::vector<int32_t> sums(std::max(max_key(orderkey), max_key(l_order)) + 1);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        __atomic_fetch_add(&sums[l_order[i].value], quantity[i].value, __ATOMIC_RELAXED);
+      }
+    });
+    auto& totalprice = db.col<orders, o_totalprice>();
+    auto& orderdate = db.col<orders, o_orderdate>();
+    std::vector<uint32_t> out;
+    for (size_t i = 0; i != orderkey.size(); ++i) {
+      if (sums[orderkey[i].value] > 30000) {
+        out.push_back(i);
+      }
+    }
+    auto top = std::min<size_t>(100, out.size());
+    std::partial_sort(out.begin(), out.begin() + top, out.end(), [&](uint32_t a, uint32_t b) {
+      return std::tie(totalprice[b], orderdate[a]) < std::tie(totalprice[a], orderdate[b]);
+    });
+    auto cust_row = key_index(db.col<customer, c_custkey>());
+    Result result;
+    for (auto i = 0ul; i != top; ++i) {
+      auto o = out[i];
+      auto cust = db.col<orders, o_custkey>()[o];
+      result.push_back(row(db.col<customer, c_name>()[cust_row[cust.value]], cust, orderkey[o], orderdate[o], totalprice[o],
+                           Decimal::buildRaw(sums[orderkey[o].value])));
+    }
+    return result;
+}
+
+Result q19(const Database& db) {
+    struct Class {
+      const char* brand;
+      const char* containers[4];
+      int32_t max_size;
+      // quantity range in cents
+      int64_t low, high;
+    };
+    static constexpr Class classes[] = {
+      {"Brand#12", {"SM CASE", "SM BOX", "SM PACK", "SM PKG"}, 5, 100, 1100},
+      {"Brand#23", {"MED BAG", "MED BOX", "MED PKG", "MED PACK"}, 10, 1000, 2000},
+      {"Brand#34", {"LG CASE", "LG BOX", "LG PACK", "LG PKG"}, 15, 2000, 3000},
+    };
+    auto& partkey = db.col<part, p_partkey>();
+    // by part key, 1 + the index of the class the part is in, 0 for none
+    std::vector<uint8_t> part_class(max_key(partkey) + 1);
+    for (size_t i = 0; i != partkey.size(); ++i) {
+      auto brand = view(db.col<part, p_brand>()[i]), container = view(db.col<part, p_container>()[i]);
+      auto size = db.col<part, p_size>()[i].value;
+      for (auto c = 0u; c != std::size(classes); ++c) {
+        auto& cls = classes[c];
+        if (brand == cls.brand && size >= 1 && size <= cls.max_size &&
+            std::find(std::begin(cls.containers), std::end(cls.containers), container) != std::end(cls.containers)) {
+          part_class[partkey[i].value] = c + 1;
+        }
+      }
+    }
+    auto& l_part = db.col<lineitem, l_partkey>();
+    auto& quantity = db.col<lineitem, l_quantity>();
+    auto& price = db.col<lineitem, l_extendedprice>();
+    auto& discount = db.col<lineitem, l_discount>();
+    auto& shipmode = db.col<lineitem, l_shipmode>();
+    auto& shipinstruct = db.col<lineitem, l_shipinstruct>();
+    std::vector<Revenue> locals(db.threads);
+    std::vector<std::vector<uint32_t>> selections(db.threads, std::vector<uint32_t>(MORSEL_ROWS));
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      // the part key is the narrowest and most selective column, the others
+      // are only read for the few rows of parts in a class
+      auto sel = selections[w].data();
+      auto count = scan::select(l_part, begin, end, [&](const Integer& key) { return part_class[key.value]; }, sel);
+      count = scan::refine_rows(sel, count, [&](uint32_t i) {
+        auto& cls = classes[part_class[l_part[i].value] - 1];
+        return quantity[i].value >= cls.low && quantity[i].value <= cls.high;
+      }, sel);
+      count = scan::refine(shipmode, sel, count, [](const auto& mode) { return view(mode) == "AIR" || view(mode) == "AIR REG"; }, sel);
+      count = scan::refine(shipinstruct, sel, count, [](const auto& instruct) { return view(instruct) == "DELIVER IN PERSON"; }, sel);
+      for (size_t i = 0; i != count; ++i) {
+        locals[w] += price[sel[i]] * (ONE - discount[sel[i]]);
+      }
+    });
+    Revenue revenue;
+    for (auto& local : locals) {
+      revenue += local;
+    }
+    return {row(revenue)};
+}
+
+Result q20(const Database& db) {
+    auto forest = like_bitmap(db.col<part, p_name>(), "forest%", db.threads);
+    auto selected = part_flags(db, [&](size_t row) { return like::test(forest, row); });
+    auto pair_key = [](int64_t part, int64_t supp) { return static_cast<uint64_t>(part) << 32 | supp; };
+    auto from = date("1994-01-01"), to = date("1995-01-01");
+    auto& l_part = db.col<lineitem, l_partkey>();
+    auto& l_supp = db.col<lineitem, l_suppkey>();
+    auto& shipdate = db.col<lineitem, l_shipdate>();
+    auto& quantity = db.col<lineitem, l_quantity>();
+    // quantities in cents
+    std::vector<std::unordered_map<uint64_t, int64_t>> locals(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        if (selected[l_part[i].value] && shipdate[i] >= from && shipdate[i] < to) {
+          locals[w][pair_key(l_part[i].value, l_supp[i].value)] += quantity[i].value;
+        }
+      }
+    });
+    auto& shipped = merge_into_first(locals);
+    auto& suppkey = db.col<supplier, s_suppkey>();
+    std::vector<uint8_t> excess(max_key(suppkey) + 1);
+    auto& ps_part = db.col<partsupp, ps_partkey>();
+    auto& ps_supp = db.col<partsupp, ps_suppkey>();
+    auto& availqty = db.col<partsupp, ps_availqty>();
+    for (size_t i = 0; i != ps_part.size(); ++i) {
+      if (!selected[ps_part[i].value]) {
+        continue;
+      }
+      auto it = shipped.find(pair_key(ps_part[i].value, ps_supp[i].value));
+      // availqty > 0.5 * sum(quantity)
+      if (it != shipped.end() && availqty[i].value * 200 > it->second) {
+        excess[ps_supp[i].value] = 1;
+      }
+    }
+    auto canada = nation_key(db, "CANADA");
+    std::vector<uint32_t> out;
+    for (size_t i = 0; i != suppkey.size(); ++i) {
+      if (excess[suppkey[i].value] && db.col<supplier, s_nationkey>()[i].value == canada) {
+        out.push_back(i);
+      }
+    }
+    auto& name = db.col<supplier, s_name>();
+    std::sort(out.begin(), out.end(), [&](uint32_t a, uint32_t b) { return view(name[a]) < view(name[b]); });
+    Result result;
+    for (auto s : out) {
+      result.push_back(row(name[s], db.col<supplier, s_address>()[s]));
+    }
+    return result;
+}
+
+// records that `supplier` occurs in an order: 0 = none yet, -1 = more than one
+inline void note_supplier(int32_t& slot, int32_t supplier) {
+    auto seen = __atomic_load_n(&slot, __ATOMIC_RELAXED);
+    while (seen != -1 && seen != supplier) {
+      if (__atomic_compare_exchange_n(&slot, &seen, seen == 0 ? supplier : -1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+}
+
+Result q21(const Database& db) {
+    auto saudi = nation_key(db, "SAUDI ARABIA");
+    auto supp_nation = supplier_nations(db);
+    auto& orderkey = db.col<orders, o_orderkey>();
+    auto& status = db.col<orders, o_orderstatus>();
+    auto& l_order = db.col<lineitem, l_orderkey>();
+    auto keys = std::max(max_key(orderkey), max_key(l_order)) + 1;
+    std::vector<uint8_t> finished(keys);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        finished[orderkey[i].value] = status[i].value == 'F';
+      }
+    });
+    auto& l_supp = db.col<lineitem, l_suppkey>();
+    auto& commitdate = db.col<lineitem, l_commitdate>();
+    auto& receiptdate = db.col<lineitem, l_receiptdate>();
+    // per order the supplier of all its items and of its late items
+    std::vector<int32_t> suppliers(keys), late_suppliers(keys);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto order = l_order[i].value;
+        if (finished[order]) {
+          note_supplier(suppliers[order], l_supp[i].value);
+          if (receiptdate[i] > commitdate[i]) {
+            note_supplier(late_suppliers[order], l_supp[i].value);
+          }
+        }
+      }
+    });
+    aggregate::Aggregation<int32_t, aggregate::Count> waiting(db.threads);
+    parallel_for(db, db.rows<lineitem>(), [&](unsigned w, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        auto order = l_order[i].value;
+        auto supp = l_supp[i].value;
+        // another supplier took part, but only this one was late
+        if (finished[order] && receiptdate[i] > commitdate[i] && supp_nation[supp] == saudi &&
+            suppliers[order] == -1 && late_suppliers[order] == supp) {
+          waiting.local(w)[supp].add();
+        }
+      }
+    });
+    auto supp_row = key_index(db.col<supplier, s_suppkey>());
+    auto& name = db.col<supplier, s_name>();
+    std::vector<std::pair<std::string_view, size_t>> out;
+    for (auto& [supp, count] : waiting.merge()) {
+      out.emplace_back(view(name[supp_row[supp]]), count.value);
+    }
+    std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return std::tie(b.second, a.first) < std::tie(a.second, b.first); });
+    Result result;
+    for (auto& [supp, count] : out) {
+      if (result.size() == 100) {
+        break;
+      }
+      result.push_back(row(supp, count));
+    }
+    return result;
+}
+
+Result q22(const Database& db) {
+    auto& custkey = db.col<customer, c_custkey>();
+    auto& phone = db.col<customer, c_phone>();
+    auto& acctbal = db.col<customer, c_acctbal>();
+    auto& o_cust = db.col<orders, o_custkey>();
+    std::vector<uint8_t> has_orders(std::max(max_key(custkey), max_key(o_cust)) + 1);
+    parallel_for(db, db.rows<orders>(), [&](unsigned, size_t begin, size_t end) {
+      for (auto i = begin; i != end; ++i) {
+        __atomic_store_n(&has_orders[o_cust[i].value], 1, __ATOMIC_RELAXED);
+      }
+    });
+    constexpr std::string_view codes[] = {"13", "31", "23", "29", "30", "18", "17"};
+    auto code = [&](size_t i) { return view(phone[i]).substr(0, 2); };
+    auto selected = [&](size_t i) { return std::find(std::begin(codes), std::end(codes), code(i)) != std::end(codes); };
+    int64_t positive_sum = 0, positive_count = 0;
+    for (size_t i = 0; i != custkey.size(); ++i) {
+      if (acctbal[i].value > 0 && selected(i)) {
+        positive_sum += acctbal[i].value;
+        ++positive_count;
+      }
+    }
+    std::map<std::string_view, std::pair<size_t, Decimal>> groups;
+    for (size_t i = 0; i != custkey.size(); ++i) {
+      // acctbal > avg(acctbal)
+      if (selected(i) && acctbal[i].value * positive_count > positive_sum && !has_orders[custkey[i].value]) {
+        auto& group = groups[code(i)];
+        ++group.first;
+        group.second += acctbal[i];
+      }
+    }
+    Result result;
+    for (auto& [code, group] : groups) {
+      result.push_back(row(code, group.first, group.second));
+    }
+    return result;
+}
+
+constexpr Result (*QUERIES[23])(const Database&) = {
+    nullptr, q1, q2, q3, q4, q5, q6, q7, q8, q9, q10, q11, q12, q13, q14, q15, q16, q17, q18, q19, q20, q21, q22,
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<unsigned> selected;
+    if (auto list = getenv("QUERIES")) {
+      for (auto str = list; *str;) {
+        char* end;
+        auto q = strtoul(str, &end, 10);
+        if (end == str || q < 1 || q > 22) {
+          std::cerr << "QUERIES must list numbers from 1 to 22" << std::endl;
+          return 1;
+        }
+        selected.push_back(q);
+        str = *end ? end + 1 : end;
+      }
+    } else {
+      for (auto q = 1u; q <= 22; ++q) {
+        selected.push_back(q);
+      }
+    }
+    bool print = getenv("PRINT") && atoi(getenv("PRINT")) != 0;
+    try {
+      auto cfg = read_config();
+      Database db(cfg.input, cfg.threads);
+      double sf = getenv("SF") ? atof(getenv("SF")) : db.rows<orders>() / 1'500'000.0;
+      bool check = std::abs(sf - 1.0) < 1e-9;
+      std::cout << "threads: " << cfg.threads << ", scale factor: " << sf
+                << (check ? "" : ", result counts are only checked at SF 1") << std::endl;
+      bool ok = true;
+      double total = 0;
+      for (auto q : selected) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = QUERIES[q](db);
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+        total += secs.count();
+        std::cout << "Q" << q << ": " << result.size() << " rows in " << secs.count() << "s";
+        if (check) {
+          ok &= result.size() == SF1_COUNTS[q];
+          std::cout << (result.size() == SF1_COUNTS[q] ? " ok" : " MISMATCH, expected " + std::to_string(SF1_COUNTS[q]));
+        }
+        std::cout << std::endl;
+        if (print) {
+          for (auto& line : result) {
+            std::cout << "  " << line << std::endl;
+          }
+        }
+      }
+      std::cout << "ran " << selected.size() << " queries in " << total << "s" << std::endl;
+      return ok ? 0 : 1;
+    } catch (const char* error) {
+      std::cerr << "error: " << error << std::endl;
+      return 1;
+    }
+}
@@ -0,0 +1,62 @@
+#include "csv-read/csv.hpp"
+#include "common.hpp"
+#include "tpch.hpp"
+#include "refresh.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+
+// applies the refresh sets 1, 2, ... found in INPUT to the tables in OUTPUT
+int main(int argc, char *argv[]) {
+    auto cfg = read_config();
+    refresh::AppliedSets applied(cfg.output);
+    refresh::DeletionBitmap deleted(cfg.output);
+    auto orders_dir = cfg.output + "orders/";
+    auto lineitem_dir = cfg.output + "lineitem/";
+    if (!std::filesystem::exists(orders_dir) || !std::filesystem::exists(lineitem_dir)) {
+      std::cerr << "convert the base tables into " << cfg.output << " first" << std::endl;
+      return 1;
+    }
+
+    for (auto set = 1u;; ++set) {
+      auto suffix = ".tbl.u" + std::to_string(set);
+      auto orders_file = cfg.input + "orders" + suffix;
+      auto lineitem_file = cfg.input + "lineitem" + suffix;
+      auto delete_file = cfg.input + "delete." + std::to_string(set);
+      bool has_updates = std::filesystem::exists(orders_file) && std::filesystem::exists(lineitem_file);
+      bool has_deletes = std::filesystem::exists(delete_file);
+      if (!has_updates && !has_deletes) {
+        break;
+      }
+      if (applied.contains(set)) {
+        std::cout << "skipping refresh set " << set << ", already applied" << std::endl;
+        continue;
+      }
+      auto start = std::chrono::steady_clock::now();
+      unsigned order_rows = 0, lineitem_rows = 0;
+      size_t keys = 0;
+      try {
+        if (has_updates) {
+          order_rows = refresh::append_segment<tpch::orders>(orders_dir, orders_file, set, cfg.options, tpch::orders_c);
+          lineitem_rows = refresh::append_segment<tpch::lineitem>(lineitem_dir, lineitem_file, set, cfg.options, tpch::lineitem_c);
+        }
+        if (has_deletes) {
+          keys = deleted.read_deletes(delete_file);
+          deleted.save(cfg.output);
+        }
+      } catch (const char* error) {
+        // the set stays unapplied without any of its segments, a rerun applies it again
+        std::filesystem::remove_all(refresh::delta_dir(orders_dir, set));
+        std::filesystem::remove_all(refresh::delta_dir(lineitem_dir, set));
+        std::cerr << "refresh set " << set << ": " << error << std::endl;
+        return 1;
+      }
+      applied.add(set);
+      std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+      std::cout << "refresh set " << set << ": appended " << order_rows << " orders and " << lineitem_rows
+                << " line items, deleted " << keys << " order keys in " << secs.count() << "s" << std::endl;
+    }
+    std::cout << deleted.count() << " order keys deleted in total" << std::endl;
+    return 0;
+}
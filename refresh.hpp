@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <charconv>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <span>
+#include "types.hpp"
+#include "common.hpp"
+
+/// TPC-H refresh functions on converted tables. RF1 update sets
+/// (<table>.tbl.u<N>) are converted into delta segments stored next to the
+/// base columns as <table>/delta.<N>/<idx>.<type>.bin, RF2 delete sets
+/// (delete.<N>) are merged into one deletion bitmap keyed by o_orderkey that
+/// applies to orders and lineitem alike. Base columns are never rewritten.
+namespace refresh {
+
+    static constexpr const char* DELTA_PREFIX = "delta.";
+    static constexpr const char* DELETED_FILE = "deleted.bin";
+    static constexpr const char* APPLIED_FILE = "refresh.applied";
+    // largest order key of a delete file, the order keys of SF 10000 fit
+    // into an 8 GiB bitmap
+    static constexpr uint64_t MAX_ORDER_KEY = 1ull << 36;
+
+    inline std::string delta_dir(const std::string& table_dir, unsigned set) {
+        return table_dir + DELTA_PREFIX + std::to_string(set) + "/";
+    }
+
+    /// Numbers of the delta segments of a table in the order they were applied.
+    inline std::vector<unsigned> delta_sets(const std::string& table_dir) {
+        std::vector<unsigned> sets;
+        if (!std::filesystem::is_directory(table_dir)) {
+            return sets;
+        }
+        for (auto& entry : std::filesystem::directory_iterator(table_dir)) {
+            auto name = entry.path().filename().string();
+            if (entry.is_directory() && name.rfind(DELTA_PREFIX, 0) == 0) {
+                sets.push_back(std::stoul(name.substr(strlen(DELTA_PREFIX))));
+            }
+        }
+        std::sort(sets.begin(), sets.end());
+        return sets;
+    }
+
+    /// Removes the delta segments of a table and the deletion bitmap and
+    /// applied sets of its output directory. Called when orders or lineitem
+    /// get a new base, the refresh sets have to be applied to it again.
+    inline void discard(const std::string& output_dir, const std::string& table_dir) {
+        std::error_code ec;
+        for (auto set : delta_sets(table_dir)) {
+            std::filesystem::remove_all(delta_dir(table_dir, set), ec);
+        }
+        std::filesystem::remove(output_dir + DELETED_FILE, ec);
+        std::filesystem::remove(output_dir + APPLIED_FILE, ec);
+    }
+
+    /// Refresh sets already applied to an output directory, so a rerun
+    /// neither appends a segment twice nor re-reads delete files.
+    struct AppliedSets {
+        std::string path;
+        std::vector<unsigned> sets;
+
+        AppliedSets(const std::string& output_dir) : path(output_dir + APPLIED_FILE) {
+            std::ifstream in(path);
+            unsigned set;
+            while (in >> set) {
+                sets.push_back(set);
+            }
+        }
+
+        inline bool contains(unsigned set) const {
+            return std::find(sets.begin(), sets.end(), set) != sets.end();
+        }
+
+        void add(unsigned set) {
+            sets.push_back(set);
+            std::ofstream out(path, std::ios::app);
+            out << set << "\n";
+        }
+    };
+
+    /// One bit per order key, set if the order and its line items were deleted.
+    struct DeletionBitmap {
+        using page_t = io::DataColumn<uint64_t>;
+
+        std::vector<uint64_t> words;
+
+        DeletionBitmap() = default;
+
+        /// Loads the bitmap of an output directory, empty if there is none.
+        explicit DeletionBitmap(const std::string& output_dir) {
+            auto path = output_dir + DELETED_FILE;
+            if (std::filesystem::exists(path)) {
+                page_t page(path.c_str());
+                words.assign(page.begin(), page.begin() + page.size());
+            }
+        }
+
+        inline void mark(uint64_t key) {
+            if (words.size() <= key / 64) {
+                words.resize(key / 64 + 1);
+            }
+            words[key / 64] |= 1ull << (key % 64);
+        }
+
+        inline bool deleted(uint64_t key) const {
+            return key / 64 < words.size() && (words[key / 64] >> (key % 64)) & 1;
+        }
+
+        size_t count() const {
+            size_t count = 0;
+            for (auto word : words) {
+                count += __builtin_popcountll(word);
+            }
+            return count;
+        }
+
+        void save(const std::string& output_dir) const {
+            auto path = output_dir + DELETED_FILE;
+            page_t page(path.c_str(), O_CREAT, page_t::GLOBAL_OVERHEAD + words.size() * sizeof(uint64_t));
+            std::copy(words.begin(), words.end(), page.begin());
+            page.flush();
+        }
+
+        /// Marks all keys of a delete file, one "<orderkey>|" per line.
+        /// Returns the number of keys read.
+        size_t read_deletes(const std::string& filename) {
+            io::MMapping<char> input(filename.c_str());
+            const char* pos = input.data();
+            const char* end = pos + input.size();
+            size_t keys = 0;
+            while (pos < end) {
+                if (*pos == '\n') {
+                    ++pos;
+                    continue;
+                }
+                uint64_t key;
+                auto [key_end, error] = std::from_chars(pos, end, key);
+                if (error != std::errc() || key > MAX_ORDER_KEY) {
+                    throw "invalid order key in delete file";
+                }
+                mark(key);
+                ++keys;
+                auto eol = static_cast<const char*>(memchr(key_end, '\n', end - key_end));
+                pos = eol ? eol + 1 : end;
+            }
+            return keys;
+        }
+    };
+
+    /// Converts an update file into the next delta segment of a table.
+    /// Malformed rows are reported on stderr; if they stop the conversion
+    /// the segment is removed again.
+    template <typename table>
+    unsigned append_segment(const std::string& table_dir, const std::string& update_file, unsigned set,
+                            const ConvertOptions& options, std::span<const char* const> columns) {
+        auto dir = delta_dir(table_dir, set);
+        bool failed;
+        unsigned rows;
+        {
+            typename table::reader reader(dir, update_file.c_str(), options);
+            rows = reader.read();
+            if (reader.report.count) {
+                reader.report.print(std::cerr, update_file, columns);
+            }
+            failed = reader.failed;
+        }
+        if (failed) {
+            std::filesystem::remove_all(dir);
+            throw "invalid update file";
+        }
+        return rows;
+    }
+
+    /// A column of a table followed by all of its delta segments. Rows are
+    /// numbered across segments in the order the segments were applied.
+    template <typename T>
+    struct SegmentedColumnInput {
+        std::deque<ColumnInput<T>> segments;
+        // first row of every segment, plus the total row count
+        std::vector<size_t> first_row;
+
+        SegmentedColumnInput(const std::string& table_dir, unsigned idx) : segments(), first_row{0} {
+            add(column_file<T>(table_dir, idx));
+            for (auto set : delta_sets(table_dir)) {
+                add(column_file<T>(delta_dir(table_dir, set), idx));
+            }
+        }
+
+        inline size_t size() const { return first_row.back(); }
+
+        inline decltype(auto) operator[](size_t row) const {
+            auto segment = std::upper_bound(first_row.begin(), first_row.end(), row) - first_row.begin() - 1;
+            return segments[segment][row - first_row[segment]];
+        }
+
+        /// Calls fn(column, first_row) for the base and each delta segment.
+        template <typename F>
+        void for_each_segment(const F& fn) const {
+            for (auto s = 0u; s != segments.size(); ++s) {
+                fn(segments[s], first_row[s]);
+            }
+        }
+
+    private:
+        void add(const std::string& filename) {
+            auto& segment = segments.emplace_back(filename.c_str());
+            first_row.push_back(first_row.back() + segment.size());
+        }
+    };
+
+} // namespace refresh
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "types.hpp"
+#include "common.hpp"
+
+/// Selection-vector scans with late materialization. A predicate on one
+/// column turns a row range into a selection vector, the ascending row
+/// numbers that passed. Further predicates only look at the selected rows
+/// and other columns are gathered at the selected rows only, so a column
+/// is read in full by the first predicate alone:
+///
+///   uint32_t sel[MORSEL_ROWS];
+///   auto n = scan::select(shipdate, begin, end, [&](const Date& d) { return d >= from && d < to; }, sel);
+///   n = scan::refine(discount, sel, n, [&](const Decimal& d) { return d >= low; }, sel);
+///   scan::gather(price, sel, n, prices);
+///
+/// Selections are built without branches on the predicate result. The
+/// inputs are anything with operator[](row), such as ColumnInput (string
+/// columns are gathered as their Char/Varchar slots), NarrowColumnInput or
+/// InlineStringInput. Selection bitmaps like those of like::evaluate convert
+/// to and from selection vectors. Whole blocks are skipped before reading
+/// them by the min/width directory of narrowed columns and the Bloom
+/// filters of key columns (BloomFilterInput::select_blocks).
+namespace scan {
+
+    using bitmap_t = std::vector<uint64_t>;
+
+    /// Stores the rows of [begin, end) whose value satisfies `predicate` in
+    /// `out` and returns their number.
+    template <typename Column, typename Predicate>
+    size_t select(const Column& column, size_t begin, size_t end, const Predicate& predicate, uint32_t* out) {
+        size_t count = 0;
+        for (auto row = begin; row != end; ++row) {
+            out[count] = row;
+            count += static_cast<bool>(predicate(column[row]));
+        }
+        return count;
+    }
+
+    /// Keeps the selected rows whose value satisfies `predicate`, `out` may
+    /// be `selection`.
+    template <typename Column, typename Predicate>
+    size_t refine(const Column& column, const uint32_t* selection, size_t count, const Predicate& predicate, uint32_t* out) {
+        size_t kept = 0;
+        for (size_t i = 0; i != count; ++i) {
+            auto row = selection[i];
+            out[kept] = row;
+            kept += static_cast<bool>(predicate(column[row]));
+        }
+        return kept;
+    }
+
+    /// Keeps the selected rows for which `predicate(row)` holds, for
+    /// conditions over several columns.
+    template <typename Predicate>
+    size_t refine_rows(const uint32_t* selection, size_t count, const Predicate& predicate, uint32_t* out) {
+        size_t kept = 0;
+        for (size_t i = 0; i != count; ++i) {
+            auto row = selection[i];
+            out[kept] = row;
+            kept += static_cast<bool>(predicate(row));
+        }
+        return kept;
+    }
+
+    /// Copies the values of the selected rows into `out`.
+    template <typename Column, typename T>
+    void gather(const Column& column, const uint32_t* selection, size_t count, T* out) {
+        for (size_t i = 0; i != count; ++i) {
+            out[i] = column[selection[i]];
+        }
+    }
+
+    /// Stores the rows of [begin, end) set in `bitmap` in `out` and returns
+    /// their number.
+    inline size_t select_bits(const bitmap_t& bitmap, size_t begin, size_t end, uint32_t* out) {
+        size_t count = 0;
+        for (auto word = begin / 64; word * 64 < end; ++word) {
+            auto bits = bitmap[word];
+            if (word == begin / 64) {
+                bits &= ~0ull << (begin % 64);
+            }
+            if ((word + 1) * 64 > end) {
+                bits &= (1ull << (end % 64)) - 1;
+            }
+            for (; bits; bits &= bits - 1) {
+                out[count++] = word * 64 + __builtin_ctzll(bits);
+            }
+        }
+        return count;
+    }
+
+    /// Keeps the selected rows that are set in `bitmap`.
+    inline size_t refine_bits(const bitmap_t& bitmap, const uint32_t* selection, size_t count, uint32_t* out) {
+        return refine_rows(selection, count, [&](uint32_t row) { return (bitmap[row / 64] >> (row % 64)) & 1; }, out);
+    }
+
+    /// Sets the bits of the selected rows in `bitmap`, which holds a bit per row.
+    inline void to_bitmap(const uint32_t* selection, size_t count, bitmap_t& bitmap) {
+        for (size_t i = 0; i != count; ++i) {
+            bitmap[selection[i] / 64] |= 1ull << (selection[i] % 64);
+        }
+    }
+
+    /// Marks the blocks of a narrowed column that may hold values in
+    /// [low, high], returns their number. Rows of other blocks need not be
+    /// read at all.
+    template <narrow::narrowable T>
+    size_t select_blocks(const NarrowColumnInput<T>& column, const T& low, const T& high, std::vector<bool>& selected) {
+        selected.assign(column.blocks, false);
+        size_t result = 0;
+        for (auto block = 0ul; block != column.blocks; ++block) {
+            selected[block] = column.base(block) <= static_cast<int64_t>(high.value) && column.max_bound(block) >= static_cast<int64_t>(low.value);
+            result += selected[block];
+        }
+        return result;
+    }
+
+} // namespace scan
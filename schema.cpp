@@ -0,0 +1,83 @@
+#include "csv-read/csv.hpp"
+#include "common.hpp"
+#include "schema.hpp"
+#include "manifest.hpp"
+
+#include <iostream>
+#include <chrono>
+
+// converts every table of the DDL file SCHEMA from INPUT/<table><SUFFIX>,
+// returns false if a table had errors and was not written
+template <char delim>
+bool convert_tables(const RunConfig& cfg, const std::vector<schema::Table>& tables, const std::string& suffix) {
+    bool ok = true;
+    for (auto& table : tables) {
+      auto dir = cfg.output + table.name + "/";
+      auto input = cfg.input + table.name + suffix;
+      if (!std::filesystem::exists(input)) {
+        std::cout << "skipping " << table.name << ", no input file " << input << std::endl;
+        continue;
+      }
+      // the column types are part of the output format
+      auto fingerprint = schema::TableConverter::fingerprint(cfg.options) + " delim=" + delim + " " + std::to_string(manifest::hash_string(table.describe()));
+      manifest::Check check(input, dir, fingerprint, cfg.options.threads, cfg.force);
+      if (check.up_to_date) {
+        check.refresh(dir);
+        std::cout << "skipping " << table.name << ", " << check.previous.rows << " rows unchanged" << std::endl;
+        continue;
+      }
+      check.invalidate(dir);
+      auto start = std::chrono::steady_clock::now();
+      size_t rows;
+      {
+        schema::TableConverter converter(table, input.c_str(), cfg.options);
+        rows = converter.read<delim>();
+        if (converter.report.count) {
+          std::vector<const char*> names;
+          for (auto& column : table.columns) {
+            names.push_back(column.name.c_str());
+          }
+          converter.report.print(std::cerr, table.name, names);
+        }
+        if (converter.failed) {
+          ok = false;
+          continue;
+        }
+        converter.write(dir);
+      }
+      check.commit(dir, rows);
+      std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+      std::cout << "read " << rows << " rows for " << table.name << " in " << secs.count() << "s" << std::endl;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    auto schema_file = getenv("SCHEMA");
+    if (!schema_file) {
+      std::cerr << "set SCHEMA to a file with CREATE TABLE statements" << std::endl;
+      return 1;
+    }
+    std::string suffix = getenv("SUFFIX") ? getenv("SUFFIX") : ".tbl";
+    std::string_view delimiter = getenv("DELIM") ? getenv("DELIM") : "|";
+    bool ok;
+    try {
+      auto cfg = read_config();
+      memory::Pool::get().limit = cfg.pool;
+      auto tables = schema::read(schema_file);
+      if (delimiter == ",") {
+        ok = convert_tables<','>(cfg, tables, suffix);
+      } else if (delimiter == "\\t" || delimiter == "\t") {
+        ok = convert_tables<'\t'>(cfg, tables, suffix);
+      } else if (delimiter == "|") {
+        ok = convert_tables<'|'>(cfg, tables, suffix);
+      } else {
+        std::cerr << "unsupported delimiter " << delimiter << std::endl;
+        return 1;
+      }
+    } catch (const char* error) {
+      std::cerr << "error: " << error << std::endl;
+      return 1;
+    }
+    return ok ? 0 : 1;
+}
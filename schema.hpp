@@ -0,0 +1,704 @@
+#pragma once
+
+#include <cstdint>
+#include <cctype>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+#include "types.hpp"
+#include "types-parse.hpp"
+#include "common.hpp"
+
+/// Runtime schemas for datasets without a TableDef in tpch.hpp. Tables are
+/// read from CREATE TABLE statements and every column is mapped to one of a
+/// fixed set of pre-instantiated types: Numeric<18, scale> for scales up to
+/// MAX_SCALE, and Char/Varchar rounded up to the next power of two. Rows are
+/// split into fields block by block, then each column parses the whole block
+/// with its typed builder, so there is one virtual call per column and block
+/// instead of one per value. Comma-separated files may quote fields as in
+/// RFC 4180, with "" for a quote inside a field; quoted fields that span
+/// several lines are reported as malformed.
+namespace schema {
+
+    enum class Kind : uint8_t { INTEGER, BIGINT, NUMERIC, CHAR, VARCHAR, DATE, TIMESTAMP };
+    constexpr char const* KIND_NAMES[] = { "integer", "bigint", "numeric", "char", "varchar", "date", "timestamp" };
+
+    static constexpr unsigned MAX_PRECISION = 18;
+    static constexpr unsigned MAX_SCALE = 8;
+    static constexpr unsigned MAX_STRING = 4096;
+
+    struct Column {
+        std::string name;
+        Kind kind = Kind::INTEGER;
+        // string length or numeric precision
+        unsigned length = 0;
+        unsigned scale = 0;
+        bool nullable = true;
+
+        /// Size of the Char/Varchar instantiation that stores the column.
+        unsigned capacity() const {
+            if (kind == Kind::CHAR && length == 1) {
+                return 1;
+            }
+            unsigned capacity = 2;
+            while (capacity < length) {
+                capacity *= 2;
+            }
+            return capacity;
+        }
+
+        /// The declared and the stored type, e.g. "varchar(44) varchar<64>".
+        std::string type_string() const {
+            std::string type = KIND_NAMES[static_cast<int>(kind)];
+            switch (kind) {
+                case Kind::NUMERIC:
+                    return type + "(" + std::to_string(length) + "," + std::to_string(scale) + ") numeric<18,"
+                           + std::to_string(scale) + ">";
+                case Kind::CHAR:
+                case Kind::VARCHAR:
+                    return type + "(" + std::to_string(length) + ") " + type + "<" + std::to_string(capacity()) + ">";
+                default:
+                    return type + " " + type;
+            }
+        }
+    };
+
+    struct Table {
+        std::string name;
+        std::vector<Column> columns;
+
+        /// One line per column, stored next to the columns and in the manifest.
+        std::string describe() const {
+            std::string result;
+            for (auto& column : columns) {
+                result += column.name + " " + column.type_string() + (column.nullable ? " null" : " not null") + "\n";
+            }
+            return result;
+        }
+    };
+
+    /// Splits DDL into lower-case words, numbers and the punctuation "(),;".
+    /// Comments (-- and /* */) and quotes around identifiers are dropped.
+    struct Lexer {
+        std::string_view text;
+        size_t pos = 0;
+
+        explicit Lexer(std::string_view text) : text(text) {}
+
+        bool done() {
+            skip();
+            return pos == text.size();
+        }
+
+        std::string next() {
+            skip();
+            if (pos == text.size()) {
+                throw "unexpected end of schema";
+            }
+            char c = text[pos];
+            if (c == '(' || c == ')' || c == ',' || c == ';' || c == '.') {
+                ++pos;
+                return std::string(1, c);
+            }
+            if (c == '"' || c == '`') {
+                auto end = text.find(c, pos + 1);
+                if (end == std::string_view::npos) {
+                    throw "unterminated quoted identifier in schema";
+                }
+                auto word = lower(text.substr(pos + 1, end - pos - 1));
+                pos = end + 1;
+                return word;
+            }
+            auto begin = pos;
+            while (pos != text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')) {
+                ++pos;
+            }
+            if (begin == pos) {
+                throw "unexpected character in schema";
+            }
+            return lower(text.substr(begin, pos - begin));
+        }
+
+        std::string peek() {
+            auto saved = pos;
+            auto word = done() ? std::string() : next();
+            pos = saved;
+            return word;
+        }
+
+        void expect(std::string_view word) {
+            if (next() != word) {
+                throw "unexpected token in schema";
+            }
+        }
+
+        unsigned number() {
+            auto word = next();
+            if (word.empty() || !std::all_of(word.begin(), word.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                throw "expected a number in schema";
+            }
+            return std::stoul(word);
+        }
+
+    private:
+        void skip() {
+            while (pos != text.size()) {
+                if (std::isspace(static_cast<unsigned char>(text[pos]))) {
+                    ++pos;
+                } else if (text.substr(pos, 2) == "--") {
+                    pos = std::min(text.size(), text.find('\n', pos));
+                } else if (text.substr(pos, 2) == "/*") {
+                    auto end = text.find("*/", pos + 2);
+                    pos = end == std::string_view::npos ? text.size() : end + 2;
+                } else {
+                    return;
+                }
+            }
+        }
+
+        static std::string lower(std::string_view word) {
+            std::string result(word);
+            for (auto& c : result) {
+                c = std::tolower(static_cast<unsigned char>(c));
+            }
+            return result;
+        }
+    };
+
+    /// Optional "(n)" or "(p, s)" behind a type name.
+    inline void parse_length(Lexer& lex, Column& column, bool required) {
+        if (lex.peek() != "(") {
+            if (required) {
+                throw "missing length of column type";
+            }
+            return;
+        }
+        lex.expect("(");
+        column.length = lex.number();
+        if (lex.peek() == ",") {
+            lex.expect(",");
+            column.scale = lex.number();
+        }
+        lex.expect(")");
+    }
+
+    inline void parse_type(Lexer& lex, Column& column) {
+        auto type = lex.next();
+        if (type == "int" || type == "integer") {
+            column.kind = Kind::INTEGER;
+        } else if (type == "bigint") {
+            column.kind = Kind::BIGINT;
+        } else if (type == "decimal" || type == "numeric") {
+            column.kind = Kind::NUMERIC;
+            column.length = MAX_PRECISION;
+            parse_length(lex, column, false);
+            if (column.length > MAX_PRECISION || column.scale > column.length) {
+                throw "unsupported numeric precision";
+            }
+            if (column.scale > MAX_SCALE) {
+                throw "unsupported numeric scale";
+            }
+        } else if (type == "char" || type == "character") {
+            column.kind = Kind::CHAR;
+            if (lex.peek() == "varying") {
+                lex.next();
+                column.kind = Kind::VARCHAR;
+            }
+            column.length = 1;
+            parse_length(lex, column, column.kind == Kind::VARCHAR);
+        } else if (type == "varchar") {
+            column.kind = Kind::VARCHAR;
+            parse_length(lex, column, true);
+        } else if (type == "date") {
+            column.kind = Kind::DATE;
+        } else if (type == "timestamp") {
+            column.kind = Kind::TIMESTAMP;
+        } else {
+            throw "unsupported column type in schema";
+        }
+        if ((column.kind == Kind::CHAR || column.kind == Kind::VARCHAR) && (column.length == 0 || column.length > MAX_STRING)) {
+            throw "unsupported string length in schema";
+        }
+    }
+
+    /// Skips the rest of a column or constraint definition and returns the
+    /// "," or ")" that ends it. Records NOT NULL for columns.
+    inline std::string skip_definition(Lexer& lex, Column* column) {
+        unsigned depth = 0;
+        while (true) {
+            auto word = lex.next();
+            if (word == "(") {
+                ++depth;
+            } else if (word == ")") {
+                if (depth == 0) {
+                    return word;
+                }
+                --depth;
+            } else if (word == "," && depth == 0) {
+                return word;
+            } else if (word == "not" && column && lex.peek() == "null") {
+                lex.next();
+                column->nullable = false;
+            } else if (word == "primary" && column && lex.peek() == "key") {
+                lex.next();
+                column->nullable = false;
+            }
+        }
+    }
+
+    /// Parses all CREATE TABLE statements of `ddl`, other statements are not supported.
+    inline std::vector<Table> parse(std::string_view ddl) {
+        static constexpr std::string_view CONSTRAINTS[] = { "primary", "foreign", "constraint", "unique", "check", "key" };
+        std::vector<Table> tables;
+        Lexer lex(ddl);
+        while (!lex.done()) {
+            if (lex.peek() == ";") {
+                lex.next();
+                continue;
+            }
+            lex.expect("create");
+            lex.expect("table");
+            Table table;
+            table.name = lex.next();
+            if (lex.peek() == ".") {
+                // schema qualified name
+                lex.next();
+                table.name = lex.next();
+            }
+            lex.expect("(");
+            for (std::string end = ","; end == ",";) {
+                auto name = lex.next();
+                if (std::find(std::begin(CONSTRAINTS), std::end(CONSTRAINTS), name) != std::end(CONSTRAINTS)) {
+                    end = skip_definition(lex, nullptr);
+                    continue;
+                }
+                Column column;
+                column.name = name;
+                parse_type(lex, column);
+                end = skip_definition(lex, &column);
+                table.columns.push_back(column);
+            }
+            if (table.columns.empty()) {
+                throw "table without columns in schema";
+            }
+            tables.push_back(std::move(table));
+        }
+        return tables;
+    }
+
+    inline std::vector<Table> read(const std::string& filename) {
+        std::ifstream in(filename);
+        if (!in) {
+            throw "could not open schema file";
+        }
+        std::stringstream text;
+        text << in.rdbuf();
+        return parse(text.str());
+    }
+
+    template <typename T>
+    struct type_tag { using type = T; };
+
+    template <unsigned scale, typename F>
+    decltype(auto) with_scale(unsigned s, const F& fn) {
+        if constexpr (scale < MAX_SCALE) {
+            if (s != scale) {
+                return with_scale<scale + 1>(s, fn);
+            }
+        }
+        return fn(type_tag<types::Numeric<MAX_PRECISION, scale>>{});
+    }
+
+    template <template <unsigned> class String, unsigned capacity, typename F>
+    decltype(auto) with_capacity(unsigned c, const F& fn) {
+        if constexpr (capacity < MAX_STRING) {
+            if (c != capacity) {
+                return with_capacity<String, capacity * 2>(c, fn);
+            }
+        }
+        return fn(type_tag<String<capacity>>{});
+    }
+
+    /// Calls fn(type_tag<T>) with the value type that stores `column`.
+    template <typename F>
+    decltype(auto) with_type(const Column& column, const F& fn) {
+        auto typed = [&](auto tag) {
+            using T = typename decltype(tag)::type;
+            if (column.nullable) {
+                return fn(type_tag<types::Nullable<T>>{});
+            }
+            return fn(tag);
+        };
+        switch (column.kind) {
+            case Kind::INTEGER: return typed(type_tag<types::Integer>{});
+            case Kind::BIGINT: return typed(type_tag<types::BigInt>{});
+            case Kind::DATE: return typed(type_tag<types::Date>{});
+            case Kind::TIMESTAMP: return typed(type_tag<types::Timestamp>{});
+            case Kind::NUMERIC: return with_scale<0>(column.scale, typed);
+            case Kind::CHAR:
+                if (column.capacity() == 1) {
+                    return typed(type_tag<types::Char<1>>{});
+                }
+                return with_capacity<types::Char, 2>(column.capacity(), typed);
+            case Kind::VARCHAR: return with_capacity<types::Varchar, 2>(column.capacity(), typed);
+        }
+        throw "unknown column kind";
+    }
+
+    /// A field of the current block, without its delimiter and quotes.
+    /// Missing fields of a short row have no begin.
+    struct Field {
+        const char* begin;
+        uint32_t len;
+        // quoted field with "" escapes, unescaped before parsing
+        bool escaped = false;
+    };
+
+    /// Parses a field, quoted fields with escapes are unescaped first.
+    template <typename T>
+    const char* cast_field(const Field& field, T& value) {
+        if (field.escaped) [[unlikely]] {
+            std::string text;
+            for (auto i = 0u; i != field.len; ++i) {
+                text.push_back(field.begin[i]);
+                i += field.begin[i] == '"';
+            }
+            return T::tryCastString(text.data(), text.size(), value);
+        }
+        return T::tryCastString(field.begin, field.len, value);
+    }
+
+    /// The fields split_row found in a row and, for a malformed row, why and
+    /// where it ends early.
+    struct RowSplit {
+        unsigned found;
+        const char* error = nullptr;
+        const char* at = nullptr;
+    };
+
+    /// Where a worker reports the malformed fields of a block, handled
+    /// according to options.errors like TableImport::reject does.
+    struct BlockErrors {
+        ingest::WorkerLog& log;
+        std::atomic<bool>& stop;
+        ingest::Policy policy;
+        const char* input;
+        // copy of a last row without newline and its offset in the input
+        std::string_view last_row = {};
+        size_t last_row_offset = 0;
+        // 1-based line of the first row of the block
+        size_t first_line = 0;
+        // rows of the block that are dropped
+        std::vector<uint8_t> dropped = {};
+
+        /// Records an error in row `r` of the block, the row keeps a NULL or
+        /// zero value under Policy::CONTINUE and is dropped otherwise.
+        void reject(size_t r, unsigned column, const char* at, const char* reason) {
+            auto offset = at >= last_row.data() && at <= last_row.data() + last_row.size()
+                              ? last_row_offset + (at - last_row.data()) : at - input;
+            log.record(first_line + r, column, offset, reason);
+            switch (policy) {
+                case ingest::Policy::CONTINUE:
+                    return;
+                case ingest::Policy::STOP:
+                    stop = true;
+                    [[fallthrough]];
+                default:
+                    dropped[r] = true;
+            }
+        }
+    };
+
+    struct ColumnBuilder {
+        virtual ~ColumnBuilder() = default;
+        virtual void resize(size_t rows) = 0;
+        /// Parses column `column` of a block into rows from `first_row` on;
+        /// `fields` points to the column's field in the first row and rows are
+        /// `stride` fields apart. Returns the contribution to the output size.
+        virtual uintptr_t parse(const Field* fields, size_t rows, unsigned stride, size_t first_row, unsigned column,
+                                BlockErrors& errors) = 0;
+        /// Forgets `rows` values from `first_row` on before they are parsed again.
+        virtual void clear_rows(size_t first_row, size_t rows) = 0;
+        virtual void move_rows(size_t from, size_t to, size_t count) = 0;
+        virtual void truncate(size_t rows) = 0;
+        virtual void write(const std::string& prefix, unsigned idx, uintptr_t parsed_size, const ConvertOptions& options) = 0;
+    };
+
+    template <typename T>
+    struct TypedBuilder final : ColumnBuilder {
+        ColumnOutput<T> output;
+
+        void resize(size_t rows) override {
+            output.resize(rows);
+        }
+
+        uintptr_t parse(const Field* fields, size_t rows, unsigned stride, size_t first_row, unsigned column,
+                        BlockErrors& errors) override {
+            uintptr_t size = 0;
+            for (auto r = 0ul; r != rows; ++r, fields += stride) {
+                if constexpr (types::IsNullable<T>::value) {
+                    if (!fields->len) {
+                        size += output.set(first_row + r, T::makeNull());
+                        continue;
+                    }
+                }
+                T value;
+                if (!fields->begin) [[unlikely]] {
+                    // reported once for the whole row
+                    value = invalid_value<T>();
+                } else if (auto error = cast_field(*fields, value)) [[unlikely]] {
+                    errors.reject(r, column, fields->begin, error);
+                    value = invalid_value<T>();
+                }
+                size += output.set(first_row + r, value);
+            }
+            return size;
+        }
+
+        void clear_rows(size_t first_row, size_t rows) override {
+            for (auto row = first_row; row != first_row + rows; ++row) {
+                output.clear_row(row);
+            }
+        }
+
+        void move_rows(size_t from, size_t to, size_t count) override {
+            output.move_rows(from, to, count);
+        }
+
+        void truncate(size_t rows) override {
+            output.truncate(rows);
+        }
+
+        void write(const std::string& prefix, unsigned idx, uintptr_t parsed_size, const ConvertOptions& options) override {
+            output.output_size += parsed_size;
+            write_column(output, column_file<T>(prefix, idx), options);
+        }
+    };
+
+    inline std::unique_ptr<ColumnBuilder> make_builder(const Column& column) {
+        return with_type(column, [](auto tag) -> std::unique_ptr<ColumnBuilder> {
+            return std::make_unique<TypedBuilder<typename decltype(tag)::type>>();
+        });
+    }
+
+    /// Converts one delimited file with a runtime schema, like TableReader
+    /// does for a TableDef.
+    struct TableConverter {
+        static constexpr size_t BLOCK_ROWS = 1024;
+        static constexpr const char* SCHEMA_FILE = "schema";
+
+        const Table& table;
+        std::vector<std::unique_ptr<ColumnBuilder>> builders;
+        std::vector<uintptr_t> sizes;
+        io::MMapping<char> input;
+        ConvertOptions options;
+        // malformed fields found by the last read
+        ingest::Report report;
+        // set if the read stopped at an error, nothing is written then
+        bool failed = false;
+
+        TableConverter(const Table& table, const char* filename, const ConvertOptions& options = {})
+            : table(table), builders(), sizes(table.columns.size()), input(filename), options(options) {
+            for (auto& column : table.columns) {
+                builders.push_back(make_builder(column));
+            }
+            if (options.hugepages) {
+                memory::advise_hugepages(input.data(), input.size());
+            }
+        }
+
+        /// The part of `options` that changes the written files, recorded in
+        /// the manifest. Only the error policy applies to schema tables.
+        static std::string fingerprint(const ConvertOptions& options) {
+            ConvertOptions used;
+            used.errors = options.errors;
+            return used.fingerprint();
+        }
+
+        /// Parses the input on all threads, returns the number of rows. Errors
+        /// are handled according to options.errors and end up in `report`.
+        template <char delim>
+        size_t read() {
+            auto threads = options.threads;
+            const char* begin = input.data();
+            const char* end = begin + input.size();
+            std::vector<const char*> bounds(threads + 1, end);
+            bounds[0] = begin;
+            for (auto w = 1u; w != threads; ++w) {
+                auto split = std::max(begin + input.size() * w / threads, bounds[w - 1]);
+                auto eol = static_cast<const char*>(memchr(split, '\n', end - split));
+                bounds[w] = eol ? eol + 1 : end;
+            }
+            std::vector<size_t> first_row(threads + 1, 0);
+            run_workers(threads, [&](unsigned w) {
+                size_t rows = std::count(bounds[w], bounds[w + 1], '\n');
+                if (bounds[w + 1] == end && bounds[w] != end && end[-1] != '\n') {
+                    ++rows; // last line without newline
+                }
+                first_row[w + 1] = rows;
+            });
+            for (auto w = 0u; w != threads; ++w) {
+                first_row[w + 1] += first_row[w];
+            }
+            auto rows = first_row[threads];
+            for (auto& builder : builders) {
+                builder->resize(rows);
+            }
+
+            std::mutex sizes_mutex;
+            // rows kept by each worker, stored from first_row[w] on
+            std::vector<size_t> kept(threads);
+            std::vector<ingest::WorkerLog> logs(threads);
+            std::atomic<bool> stop = false;
+            run_workers(threads, [&](unsigned w) {
+                memory::Topology::get().pin_worker(w);
+                auto columns = table.columns.size();
+                std::vector<Field> fields(BLOCK_ROWS * columns);
+                std::vector<uintptr_t> worker_sizes(columns), block_sizes(columns);
+                // copy of a last row without newline, the field search needs one
+                std::string last_row;
+                BlockErrors errors{logs[w], stop, options.errors, begin};
+                const char* pos = bounds[w];
+                auto out = first_row[w];
+                for (auto row = first_row[w]; row != first_row[w + 1] && !stop.load(std::memory_order_relaxed);) {
+                    auto block_rows = std::min(BLOCK_ROWS, first_row[w + 1] - row);
+                    errors.first_line = row + 1;
+                    errors.dropped.assign(block_rows, false);
+                    for (auto r = 0ul; r != block_rows; ++r) {
+                        auto row_fields = fields.data() + r * columns;
+                        RowSplit split;
+                        if (row + r + 1 == rows && end[-1] != '\n') {
+                            last_row.assign(pos, end);
+                            last_row.push_back('\n');
+                            errors.last_row = last_row;
+                            errors.last_row_offset = pos - begin;
+                            const char* copy = last_row.data();
+                            split = split_row<delim>(copy, copy + last_row.size(), row_fields, columns);
+                            pos = end;
+                        } else {
+                            split = split_row<delim>(pos, end, row_fields, columns);
+                        }
+                        if (split.error) [[unlikely]] {
+                            errors.reject(r, split.found, split.at, split.error);
+                        }
+                    }
+                    for (auto c = 0u; c != columns; ++c) {
+                        block_sizes[c] = builders[c]->parse(fields.data() + c, block_rows, columns, out, c, errors);
+                    }
+                    size_t block_kept = std::count(errors.dropped.begin(), errors.dropped.end(), false);
+                    if (block_kept != block_rows && !stop.load(std::memory_order_relaxed)) {
+                        // rare, parse the kept rows again without the dropped ones in between
+                        for (auto r = 0ul, k = 0ul; r != block_rows; ++r) {
+                            if (!errors.dropped[r]) {
+                                std::copy_n(fields.data() + r * columns, columns, fields.data() + k++ * columns);
+                            }
+                        }
+                        for (auto c = 0u; c != columns; ++c) {
+                            builders[c]->clear_rows(out, block_rows);
+                            block_sizes[c] = builders[c]->parse(fields.data() + c, block_kept, columns, out, c, errors);
+                        }
+                        logs[w].skipped_rows += block_rows - block_kept;
+                    }
+                    for (auto c = 0u; c != columns; ++c) {
+                        worker_sizes[c] += block_sizes[c];
+                    }
+                    out += block_kept;
+                    row += block_rows;
+                }
+                kept[w] = out - first_row[w];
+                std::lock_guard lock(sizes_mutex);
+                for (auto c = 0u; c != columns; ++c) {
+                    sizes[c] += worker_sizes[c];
+                }
+            });
+            report.merge(logs);
+            report.stopped = stop;
+            if (stop) {
+                failed = true;
+                return 0;
+            }
+            if (std::accumulate(kept.begin(), kept.end(), size_t(0)) != rows) {
+                rows = compact(first_row, kept);
+            }
+            return rows;
+        }
+
+        /// Writes the columns and a description of their types to `prefix`.
+        void write(const std::string& prefix) {
+            std::filesystem::create_directories(prefix);
+            for (auto c = 0u; c != builders.size(); ++c) {
+                builders[c]->write(prefix, c, sizes[c], options);
+            }
+            std::ofstream(prefix + SCHEMA_FILE) << table.describe();
+        }
+
+    private:
+        /// Moves the rows kept by each worker behind those of the previous
+        /// workers, returns the number of rows left.
+        size_t compact(const std::vector<size_t>& first_row, const std::vector<size_t>& kept) {
+            size_t rows = kept[0];
+            for (auto w = 1u; w < kept.size(); ++w) {
+                for (auto& builder : builders) {
+                    builder->move_rows(first_row[w], rows, kept[w]);
+                }
+                rows += kept[w];
+            }
+            for (auto& builder : builders) {
+                builder->truncate(rows);
+            }
+            return rows;
+        }
+
+        /// Records the fields of the row at `pos` and moves `pos` to the start
+        /// of the next row. Fields of comma-separated rows may be quoted.
+        template <char delim>
+        static RowSplit split_row(const char*& pos, const char* end, Field* fields, unsigned columns) {
+            RowSplit split{columns};
+            for (auto c = 0u; c != columns; ++c) {
+                CharIter iter{pos};
+                if (delim == ',' && *pos == '"') [[unlikely]] {
+                    // rows end with a newline, so the scan stops before `end`
+                    auto close = pos + 1;
+                    bool escaped = false;
+                    while (*close != '\n' && (*close != '"' || close[1] == '"')) {
+                        escaped |= *close == '"';
+                        close += *close == '"' ? 2 : 1;
+                    }
+                    if (*close == '\n' || (close[1] != delim && close[1] != '\n')) [[unlikely]] {
+                        split = RowSplit{c, *close == '\n' ? "quoted field spans lines" : "invalid quoted field", pos};
+                        std::fill(fields + c, fields + columns, Field{nullptr, 0});
+                        iter.iter = close;
+                        io::csv::find<'\n'>(iter);
+                        pos = iter.iter + 1;
+                        break;
+                    }
+                    fields[c] = Field{pos + 1, static_cast<uint32_t>(close - pos - 1), escaped};
+                    iter.iter = close + 1;
+                } else {
+                    io::csv::find_either<delim, '\n'>(iter);
+                    fields[c] = Field{pos, static_cast<uint32_t>(iter.iter - pos)};
+                }
+                pos = iter.iter + 1;
+                if (*iter.iter == '\n' && c + 1 != columns) [[unlikely]] {
+                    std::fill(fields + c + 1, fields + columns, Field{nullptr, 0});
+                    split = RowSplit{c + 1, "missing fields", iter.iter};
+                    break;
+                }
+            }
+            if (pos >= end || pos[-1] == '\n') {
+                pos = std::min(pos, end);
+                return split;
+            }
+            // trailing delimiter or ignored extra fields
+            auto eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+            pos = eol ? eol + 1 : end;
+            return split;
+        }
+    };
+
+} // namespace schema
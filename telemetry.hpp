@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "memory.hpp"
+#include "async-writer.hpp"
+
+/// Live progress of a conversion. A background thread samples the bytes of
+/// the input consumed and the rows parsed by every worker each `interval`
+/// seconds and reports throughput, the ETA, the share of wall time every
+/// worker spent on a CPU and the resident memory to stderr and optionally
+/// as JSON lines to a file and to a Unix datagram socket:
+///
+///   TELEMETRY=2 TELEMETRY_FILE=progress.jsonl ./all.out
+///   socat UNIX-RECV:/tmp/convert.sock - & TELEMETRY=2 TELEMETRY_SOCKET=/tmp/convert.sock ./all.out
+///
+/// Workers publish their position every PUBLISH_ROWS rows into their own
+/// cache line, so the parsers never share a counter. Low utilization with a
+/// flat byte count points at page faults on the input, a table stuck in the
+/// write phase at the output device.
+namespace telemetry {
+
+    // rows a worker parses between two updates of its counters
+    static constexpr uint64_t PUBLISH_ROWS = 4096;
+
+    struct Options {
+        // seconds between two reports, off if 0
+        double interval = 0;
+        // JSON lines are appended to this file
+        std::string file;
+        // JSON lines are sent to this datagram socket, dropped if nobody listens
+        std::string socket;
+    };
+
+    inline int64_t thread_cpu_ns(clockid_t clock) {
+        timespec ts;
+        if (clock_gettime(clock, &ts)) {
+            return -1;
+        }
+        return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+    }
+
+    /// Counters of one worker, written only by the worker.
+    struct alignas(64) Worker {
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<uint64_t> rows = 0;
+        std::atomic<bool> running = false;
+        // CPU time of the thread at start() and, once finished, spent since
+        int64_t start_ns = 0;
+        std::atomic<int64_t> spent_ns = 0;
+        clockid_t clock;
+
+        /// Called on the worker thread before it starts parsing.
+        void start() {
+            bytes.store(0, std::memory_order_relaxed);
+            rows.store(0, std::memory_order_relaxed);
+            pthread_getcpuclockid(pthread_self(), &clock);
+            start_ns = thread_cpu_ns(clock);
+            spent_ns = 0;
+            running = true;
+        }
+
+        inline void publish(uint64_t consumed, uint64_t parsed) {
+            bytes.store(consumed, std::memory_order_relaxed);
+            rows.store(parsed, std::memory_order_relaxed);
+        }
+
+        /// Called on the worker thread when it is done, its clock dies with it.
+        void finish(uint64_t consumed, uint64_t parsed) {
+            publish(consumed, parsed);
+            spent_ns = thread_cpu_ns(clock) - start_ns;
+            running = false;
+        }
+
+        /// CPU time since start().
+        inline int64_t cpu_time() const {
+            if (!running) {
+                return spent_ns;
+            }
+            auto now = thread_cpu_ns(clock);
+            return now < 0 ? spent_ns.load() : now - start_ns;
+        }
+    };
+
+    class Monitor {
+    public:
+        Monitor(const Options& options, unsigned threads, uint64_t total_bytes, const aio::AsyncWriter* writer = nullptr)
+            : options(options), workers(threads), total_bytes(total_bytes), writer(writer), started(clock::now()) {
+            if (!options.file.empty()) {
+                file.open(options.file, std::ios::app);
+                if (!file) {
+                    throw "cannot open TELEMETRY_FILE";
+                }
+            }
+            if (!options.socket.empty()) {
+                if (options.socket.size() >= sizeof(address.sun_path)) {
+                    throw "TELEMETRY_SOCKET path too long";
+                }
+                socket_fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+                address.sun_family = AF_UNIX;
+                strcpy(address.sun_path, options.socket.c_str());
+            }
+            reporter = std::thread([this]() { report_loop(); });
+        }
+
+        ~Monitor() {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            cv.notify_all();
+            reporter.join();
+            if (socket_fd >= 0) {
+                close(socket_fd);
+            }
+        }
+
+        inline Worker& worker(unsigned id) { return workers[id]; }
+
+        /// A table of `bytes` input bytes is parsed next.
+        void begin_table(const std::string& name, uint64_t bytes) {
+            std::lock_guard lock(mutex);
+            for (auto& w : workers) {
+                w.publish(0, 0);
+                w.running = false;
+                w.spent_ns = 0;
+            }
+            table = name;
+            table_bytes = bytes;
+            phase = "parse";
+            table_started = last_sample = clock::now();
+            last_bytes = last_rows = 0;
+            last_cpu.assign(workers.size(), 0);
+        }
+
+        /// The table is parsed, its columns are being written.
+        void begin_write() {
+            std::lock_guard lock(mutex);
+            phase = "write";
+        }
+
+        /// The table is converted or skipped.
+        void end_table(uint64_t bytes) {
+            std::lock_guard lock(mutex);
+            done_bytes += bytes;
+            table.clear();
+            phase = "idle";
+        }
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        Options options;
+        std::vector<Worker> workers;
+        uint64_t total_bytes;
+        const aio::AsyncWriter* writer;
+        clock::time_point started;
+        std::ofstream file;
+        int socket_fd = -1;
+        sockaddr_un address{};
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool stopping = false;
+        std::thread reporter;
+        // guarded by mutex
+        std::string table;
+        const char* phase = "idle";
+        uint64_t table_bytes = 0;
+        uint64_t done_bytes = 0;
+        clock::time_point table_started, last_sample;
+        uint64_t last_bytes = 0, last_rows = 0;
+        size_t last_written = 0;
+        std::vector<int64_t> last_cpu;
+
+        void report_loop() {
+            std::unique_lock lock(mutex);
+            auto interval = std::chrono::duration<double>(options.interval);
+            while (!cv.wait_for(lock, interval, [this]() { return stopping; })) {
+                report();
+            }
+        }
+
+        void report() {
+            auto now = clock::now();
+            std::chrono::duration<double> elapsed = now - last_sample, in_table = now - table_started, total = now - started;
+            uint64_t bytes = 0, rows = 0;
+            std::vector<double> utilization(workers.size(), 0);
+            last_cpu.resize(workers.size(), 0);
+            for (auto w = 0u; w != workers.size(); ++w) {
+                bytes += workers[w].bytes.load(std::memory_order_relaxed);
+                rows += workers[w].rows.load(std::memory_order_relaxed);
+                auto cpu = workers[w].cpu_time();
+                utilization[w] = elapsed.count() > 0 ? std::min(1.0, (cpu - last_cpu[w]) / 1e9 / elapsed.count()) : 0;
+                last_cpu[w] = cpu;
+            }
+            bytes = std::min(bytes, table_bytes);
+            auto seconds = std::max(elapsed.count(), 1e-9);
+            double rows_per_s = (rows - std::min(rows, last_rows)) / seconds;
+            double mb_per_s = (bytes - std::min(bytes, last_bytes)) / seconds / (1 << 20);
+            size_t written = writer ? writer->written() : 0;
+            double written_mb_per_s = (written - std::min(written, last_written)) / seconds / (1 << 20);
+            // the ETA extrapolates the average rate of the current table, -1 if unknown
+            double rate = in_table.count() > 0 ? bytes / in_table.count() : 0;
+            double eta = rate > 0 ? (table_bytes - bytes) / rate : -1;
+            double total_eta = rate > 0 ? (total_bytes - std::min(total_bytes, done_bytes + bytes)) / rate : -1;
+            long rss_kb = memory::Usage::resident_kb();
+            last_sample = now;
+            last_bytes = bytes;
+            last_rows = rows;
+            last_written = written;
+
+            auto seconds_text = [](double s) { return s < 0 ? std::string("-") : std::to_string(static_cast<long>(s + 0.5)) + "s"; };
+            char line[256];
+            snprintf(line, sizeof(line), "[%.0fs] %s %s %.1f%% (%llu MiB), %.0f rows/s, %.1f MiB/s, eta %s (total %s)",
+                     total.count(), table.empty() ? "-" : table.c_str(), phase,
+                     table_bytes ? 100.0 * bytes / table_bytes : 0.0, static_cast<unsigned long long>(bytes >> 20),
+                     rows_per_s, mb_per_s, seconds_text(eta).c_str(), seconds_text(total_eta).c_str());
+            std::ostringstream workers_text;
+            for (auto u : utilization) {
+                workers_text << ' ' << static_cast<int>(u * 100) << '%';
+            }
+            std::cerr << line << ", workers" << workers_text.str() << ", rss " << (rss_kb >> 10) << " MiB";
+            if (writer) {
+                std::cerr << ", written " << (written >> 20) << " MiB (" << written_mb_per_s << " MiB/s)";
+            }
+            std::cerr << std::endl;
+
+            if (!file.is_open() && socket_fd < 0) {
+                return;
+            }
+            std::ostringstream json;
+            json << "{\"time\":" << total.count() << ",\"table\":\"" << table << "\",\"phase\":\"" << phase
+                 << "\",\"bytes\":" << bytes << ",\"table_bytes\":" << table_bytes << ",\"rows\":" << rows
+                 << ",\"rows_per_s\":" << rows_per_s << ",\"mb_per_s\":" << mb_per_s
+                 << ",\"eta_s\":" << eta << ",\"total_eta_s\":" << total_eta << ",\"workers\":[";
+            for (auto w = 0u; w != utilization.size(); ++w) {
+                json << (w ? "," : "") << utilization[w];
+            }
+            json << "],\"rss_bytes\":" << (rss_kb << 10) << ",\"written_bytes\":" << written << "}\n";
+            auto text = json.str();
+            if (file.is_open()) {
+                file << text << std::flush;
+            }
+            if (socket_fd >= 0) {
+                sendto(socket_fd, text.data(), text.size(), MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+            }
+        }
+    };
+
+} // namespace telemetry
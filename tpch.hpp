@@ -3,6 +3,7 @@
 #include "types.hpp"
 #include "types-parse.hpp"
 #include "common.hpp"
+#include "verify.hpp"
 
 namespace tpch {
     using namespace types;
@@ -12,6 +13,8 @@ namespace tpch {
     struct TableDef {
         using import = TableImport<Ts...>;
         using reader = TableReader<Ts...>;
+        using exporter = TableExport<Ts...>;
+        using verifier = verify::TableChecksums<Ts...>;
         using columns = typename import::tuple_type;
 
         template <template <typename> class Container>
@@ -26,7 +29,7 @@ namespace tpch {
      *  N_COMMENT    VARCHAR(152)
      * );
      **/
-    using nation = TableDef<Integer, Char<25>, Integer, Varchar<152>>;
+    using nation = TableDef<Integer, Char<25>, Integer, Nullable<Varchar<152>>>;
     [[maybe_unused]] constexpr std::array nation_c { "n_nationkey", "n_name", "n_regionkey", "n_comment" };
     enum nation_columns : uint8_t { n_nationkey, n_name, n_regionkey, n_comment };
 
@@ -123,7 +126,7 @@ namespace tpch {
      *   R_COMMENT    VARCHAR(152)
      * );
      **/
-    using region = TableDef<Integer, Char<25>, Varchar<152>>;
+    using region = TableDef<Integer, Char<25>, Nullable<Varchar<152>>>;
     [[maybe_unused]] constexpr std::array region_c { "r_regionkey", "r_name", "r_comment" };
     enum region_columns : uint8_t { r_regionkey, r_name, r_comment };
 
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "types.hpp"
+
+namespace io::csv {
+
+    /// Hand-written text formatters, the inverse of the `Parser<T>`s in
+    /// types-parse.hpp. `format` writes into `out` without bounds checks and
+    /// returns the position behind the last written character; callers must
+    /// reserve at least `MAX_WIDTH` bytes per value.
+    template<typename T> struct Formatter;
+
+    namespace format {
+        static constexpr char DIGIT_PAIRS[201] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+        /// write an unsigned number, two digits at a time
+        inline char* write_unsigned(char* out, uint64_t v) {
+            char buffer[20];
+            char* pos = buffer + sizeof(buffer);
+            while (v >= 100) {
+                auto pair = (v % 100) * 2;
+                v /= 100;
+                pos -= 2;
+                memcpy(pos, DIGIT_PAIRS + pair, 2);
+            }
+            if (v >= 10) {
+                pos -= 2;
+                memcpy(pos, DIGIT_PAIRS + v * 2, 2);
+            } else {
+                *--pos = static_cast<char>('0' + v);
+            }
+            auto len = buffer + sizeof(buffer) - pos;
+            memcpy(out, pos, len);
+            return out + len;
+        }
+
+        inline char* write_signed(char* out, int64_t v) {
+            if (v < 0) {
+                *out++ = '-';
+                return write_unsigned(out, -static_cast<uint64_t>(v));
+            }
+            return write_unsigned(out, v);
+        }
+
+        /// write exactly `digits` digits, zero-padded
+        inline char* write_padded(char* out, uint64_t v, unsigned digits) {
+            for (auto pos = out + digits; pos != out;) {
+                *--pos = static_cast<char>('0' + v % 10);
+                v /= 10;
+            }
+            return out + digits;
+        }
+
+        inline char* write_pair(char* out, unsigned v) {
+            memcpy(out, DIGIT_PAIRS + v * 2, 2);
+            return out + 2;
+        }
+    } // namespace format
+
+    template<>
+    struct Formatter<types::Integer> {
+        static constexpr unsigned MAX_WIDTH = 11;
+        static inline char* format(char* out, const types::Integer& v) { return format::write_signed(out, v.value); }
+    };
+
+    template<>
+    struct Formatter<types::BigInt> {
+        static constexpr unsigned MAX_WIDTH = 20;
+        static inline char* format(char* out, const types::BigInt& v) { return format::write_signed(out, v.value); }
+    };
+
+    template<unsigned len, unsigned precision>
+    struct Formatter<types::Numeric<len, precision>> {
+        static constexpr unsigned MAX_WIDTH = 22;
+        static inline char* format(char* out, const types::Numeric<len, precision>& n) {
+            int64_t v = n.value;
+            if (v < 0) {
+                *out++ = '-';
+                v = -v;
+            }
+            if constexpr (precision == 0) {
+                return format::write_unsigned(out, v);
+            } else {
+                constexpr uint64_t shift = types::numericShifts[precision];
+                out = format::write_unsigned(out, v / shift);
+                *out++ = '.';
+                return format::write_padded(out, v % shift, precision);
+            }
+        }
+        /// dbgen prints some decimals (l_quantity) without fraction digits
+        static inline char* format_integral(char* out, const types::Numeric<len, precision>& n) {
+            constexpr uint64_t shift = types::numericShifts[precision];
+            if (n.value % static_cast<int64_t>(shift) != 0) {
+                return format(out, n);
+            }
+            return format::write_signed(out, n.value / static_cast<int64_t>(shift));
+        }
+    };
+
+    template<>
+    struct Formatter<types::Date> {
+        static constexpr unsigned MAX_WIDTH = 10;
+        static inline char* format(char* out, const types::Date& d) {
+            unsigned year, month, day;
+            types::splitJulianDay(d.value, year, month, day);
+            out = format::write_pair(out, year / 100);
+            out = format::write_pair(out, year % 100);
+            *out++ = '-';
+            out = format::write_pair(out, month);
+            *out++ = '-';
+            return format::write_pair(out, day);
+        }
+    };
+
+    template<unsigned maxLen>
+    struct Formatter<types::Char<maxLen>> {
+        static constexpr unsigned MAX_WIDTH = maxLen;
+        static inline char* format(char* out, const types::Char<maxLen>& s) {
+            memcpy(out, s.value, s.len);
+            return out + s.len;
+        }
+    };
+
+    template<>
+    struct Formatter<types::Char<1>> {
+        static constexpr unsigned MAX_WIDTH = 1;
+        static inline char* format(char* out, const types::Char<1>& s) {
+            // Char<1>::length() treats ' ' as empty, but .tbl files keep it
+            *out = s.value;
+            return out + 1;
+        }
+    };
+
+    template<unsigned maxLen>
+    struct Formatter<types::Varchar<maxLen>> {
+        static constexpr unsigned MAX_WIDTH = maxLen;
+        static inline char* format(char* out, const types::Varchar<maxLen>& s) {
+            memcpy(out, s.value, s.len);
+            return out + s.len;
+        }
+    };
+
+    template<typename T>
+    struct Formatter<types::Nullable<T>> {
+        static constexpr unsigned MAX_WIDTH = Formatter<T>::MAX_WIDTH;
+        static inline char* format(char* out, const types::Nullable<T>& v) {
+            // NULL is an empty field
+            return v.null ? out : Formatter<T>::format(out, v.value);
+        }
+    };
+
+}
@@ -16,6 +16,14 @@ namespace io::csv {
            assert(pos.iter != nullptr && (*pos.iter == delim || *pos.iter == eol));
            return T::castString(start, pos.iter - start);
        }
+
+       /// Like parse_value, but returns an error message instead of throwing.
+       template <char delim, char eol = '\n'>
+       inline const char* try_parse_value(CharIter& pos, T& value) {
+           auto start = pos.iter;
+           find_either<delim, eol>(pos);
+           return T::tryCastString(start, pos.iter - start, value);
+       }
     };
 
 }
@@ -133,7 +133,8 @@ public:
    /// Mul
    inline BigInt operator*(const BigInt& n) const { BigInt r; r.value=value*n.value; return r; }
    /// Cast
-   static BigInt castString(const char* str, uint32_t strLen) {
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str, uint32_t strLen, BigInt& r) {
        auto iter = str, limit = str + strLen;
 
        // Trim WS
@@ -152,7 +153,7 @@ public:
        }
 
        // Parse
-       if (iter == limit) throw "invalid number format: found non-integer characters";
+       if (iter == limit) return "invalid number format: found non-integer characters";
 
        uint64_t result = 0;
        unsigned digitsSeen = 0;
@@ -164,15 +165,20 @@ public:
            } else if (c == '.') {
                break;
            } else {
-               throw "invalid number format: invalid character in integer string";
+               return "invalid number format: invalid character in integer string";
            }
        }
 
        if (digitsSeen > 20 || result > std::numeric_limits<int64_t>::max())
-           throw "invalid number format: too many characters (64bit integers can at most consist of 20 numeric characters)";
+           return "invalid number format: too many characters (64bit integers can at most consist of 20 numeric characters)";
 
-       BigInt r;
        r.value = neg ? -result : result;
+       return nullptr;
+   }
+   /// Cast
+   static BigInt castString(const char* str, uint32_t strLen) {
+       BigInt r;
+       if (auto error = tryCastString(str, strLen, r)) throw error;
        return r;
    }
    // output
@@ -222,7 +228,8 @@ public:
    /// Conversion to BigInt for comparisons
    inline operator BigInt() const { return BigInt(value); }
    /// Cast
-   static Integer castString(const char* str, uint32_t strLen) {
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str, uint32_t strLen, Integer& r) {
        auto iter = str, limit = str + strLen;
 
        // Trim WS
@@ -241,7 +248,7 @@ public:
        }
 
        // Parse
-       if (iter == limit) throw "invalid number format: found non-integer characters";
+       if (iter == limit) return "invalid number format: found non-integer characters";
 
        int64_t result = 0;
        unsigned digitsSeen = 0;
@@ -253,15 +260,20 @@ public:
            } else if (c == '.') {
                break;
            } else {
-               throw "invalid number format: invalid character in integer string";
+               return "invalid number format: invalid character in integer string";
            }
        }
 
        if (digitsSeen > 10 || result > std::numeric_limits<int32_t>::max())
-           throw "invalid number format: too many characters (32bit integers can at most consist of 10 numeric characters)";
+           return "invalid number format: too many characters (32bit integers can at most consist of 10 numeric characters)";
 
-       Integer r;
        r.value = neg ? -result : result;
+       return nullptr;
+   }
+   /// Cast
+   static Integer castString(const char* str, uint32_t strLen) {
+       Integer r;
+       if (auto error = tryCastString(str, strLen, r)) throw error;
        return r;
    }
    // output
@@ -313,8 +325,19 @@ public:
 
    /// Build
    static Varchar build(const char* value) { Varchar result; strncpy(result.value,value,maxLen); result.len=strnlen(value,maxLen); return result; }
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str,uint32_t strLen,Varchar& result) {
+      if (strLen>maxLen)
+         return "string too long";
+      result.len=strLen; memcpy(result.value,str,strLen);
+      return nullptr;
+   }
    ///Cast
-   static Varchar<maxLen> castString(const char* str,uint32_t strLen) {assert(strLen<=maxLen); Varchar<maxLen> result; result.len=strLen; memcpy(result.value,str,strLen); return result;};
+   static Varchar<maxLen> castString(const char* str,uint32_t strLen) {
+      Varchar<maxLen> result;
+      if (auto error=tryCastString(str,strLen,result)) throw error;
+      return result;
+   };
 };
 //---------------------------------------------------------------------------
 template <unsigned maxLen> bool contains(const Varchar<maxLen>& str,const char* txt,unsigned len)
@@ -407,13 +430,22 @@ public:
 
    /// Build
    static Char build(const char* value) { Char result; memcpy(result.value,value,maxLen); result.len=strnlen(result.value,maxLen); return result; }
-   /// Cast
-   static Char<maxLen> castString(const char* str,uint32_t strLen) {
-      while ((*str)==' ') {
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str,uint32_t strLen,Char& result) {
+      while (strLen&&((*str)==' ')) {
          str++;
          strLen--;
       }
-      assert(strLen<=maxLen); Char<maxLen> result; result.len=strLen; memcpy(result.value,str,strLen); return result;
+      if (strLen>maxLen)
+         return "string too long";
+      result.len=strLen; memcpy(result.value,str,strLen);
+      return nullptr;
+   }
+   /// Cast
+   static Char<maxLen> castString(const char* str,uint32_t strLen) {
+      Char<maxLen> result;
+      if (auto error=tryCastString(str,strLen,result)) throw error;
+      return result;
    }
 };
 //---------------------------------------------------------------------------
@@ -491,9 +523,16 @@ public:
 
    /// Build
    static Char build(const char* value) { Char result; result.value=*value; return result; }
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str,uint32_t strLen,Char& result) {
+      if (strLen>1)
+         return "string too long";
+      result.value=strLen ? str[0] : ' ';
+      return nullptr;
+   }
    static Char<1> castString(const char* str,uint32_t strLen) {
       Char<1> x;
-      x.value=str[0];
+      if (auto error=tryCastString(str,strLen,x)) throw error;
       return x;
    }
 };
@@ -615,7 +654,8 @@ public:
        return r;
    }
    /// Cast
-   static Numeric<len,precision> castString(const char* str,uint32_t strLen) {
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str,uint32_t strLen,Numeric& r) {
       auto iter=str,limit=str+strLen;
 
       // Trim WS
@@ -635,7 +675,7 @@ public:
 
       // Parse
       if (iter==limit)
-         throw "invalid number format: found non-numeric characters";
+         return "invalid number format: found non-numeric characters";
 
       int64_t result=0;
       bool fraction=false;
@@ -653,23 +693,26 @@ public:
             }
          } else if (c=='.') {
             if (fraction)
-               throw "invalid number format: already in fraction";
+               return "invalid number format: already in fraction";
             while ((iter!=limit)&&((*(limit-1))=='0')) --limit; // skip trailing 0s
             fraction=true;
          } else {
-            throw "invalid number format: invalid character in numeric string";
+            return "invalid number format: invalid character in numeric string";
          }
       }
 
       if ((digitsSeen>18/*(len-precision)*/)||(digitsSeenFraction>precision))
-         throw "invalid number format: loosing precision";
+         return "invalid number format: loosing precision";
 
       result*=numericShifts[precision-digitsSeenFraction];
-      if (neg) {
-         return buildRaw(-result);
-      } else {
-         return buildRaw(result);
-      }
+      r.value=neg ? -result : result;
+      return nullptr;
+   }
+   /// Cast
+   static Numeric<len,precision> castString(const char* str,uint32_t strLen) {
+      Numeric r;
+      if (auto error=tryCastString(str,strLen,r)) throw error;
+      return r;
    }
 };
 //---------------------------------------------------------------------------
@@ -790,7 +833,8 @@ class Date
        return out << buffer;
    }
    /// Cast
-   static Date castString(const char* str, uint32_t strLen) {
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str, uint32_t strLen, Date& d) {
        auto iter = str, limit = str + strLen;
        // Trim WS
        while ((iter != limit) && ((*iter) == ' ')) ++iter;
@@ -798,24 +842,24 @@ class Date
        // Year
        unsigned year = 0;
        while (true) {
-           if (iter == limit) throw "invalid date format";
+           if (iter == limit) return "invalid date format";
            char c = *(iter++);
            if (c == '-') break;
            if ((c >= '0') && (c <= '9')) {
                year = 10 * year + (c - '0');
            } else
-               throw "invalid date format";
+               return "invalid date format";
        }
        // Month
        unsigned month = 0;
        while (true) {
-           if (iter == limit) throw "invalid date format";
+           if (iter == limit) return "invalid date format";
            char c = *(iter++);
            if (c == '-') break;
            if ((c >= '0') && (c <= '9')) {
                month = 10 * month + (c - '0');
            } else
-               throw "invalid date format";
+               return "invalid date format";
        }
        // Day
        unsigned day = 0;
@@ -825,13 +869,18 @@ class Date
            if ((c >= '0') && (c <= '9')) {
                day = 10 * day + (c - '0');
            } else
-               throw "invalid date format";
+               return "invalid date format";
        }
        // Range check
        if ((year > 9999) || (month < 1) || (month > 12) || (day < 1) || (day > 31))
-           throw "invalid date format";
-       Date d;
+           return "invalid date format";
        d.value = mergeJulianDay(year, month, day);
+       return nullptr;
+   }
+   /// Cast
+   static Date castString(const char* str, uint32_t strLen) {
+       Date d;
+       if (auto error = tryCastString(str, strLen, d)) throw error;
        return d;
    }
 
@@ -875,8 +924,14 @@ public:
    bool operator<(const Timestamp& t) const { return value<t.value; }
    /// Comparison
    bool operator>(const Timestamp& t) const { return value>t.value; }
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str,uint32_t strLen,Timestamp& result);
    /// Cast
-   static Timestamp castString(const char* str,uint32_t strLen);
+   static Timestamp castString(const char* str,uint32_t strLen) {
+      Timestamp result;
+      if (auto error=tryCastString(str,strLen,result)) throw error;
+      return result;
+   }
 
    /// Output
    friend std::ostream& operator<<(std::ostream& out, const Timestamp& value) {
@@ -900,7 +955,174 @@ public:
    }
 };
 //---------------------------------------------------------------------------
+inline const char* Timestamp::tryCastString(const char* str,uint32_t strLen,Timestamp& result)
+// Cast "yyyy-mm-dd[ hh:mm[:ss[.fff]]]", also with 'T' as separator
+{
+   auto iter=str,limit=str+strLen;
+   // Trim WS
+   while ((iter!=limit)&&((*iter)==' ')) ++iter;
+   while ((iter!=limit)&&((*(limit-1))==' ')) --limit;
+   auto dateEnd=iter;
+   while ((dateEnd!=limit)&&((*dateEnd)!=' ')&&((*dateEnd)!='T')) ++dateEnd;
+   Date date;
+   if (auto error=Date::tryCastString(iter,dateEnd-iter,date))
+      return error;
+   // Time of day
+   unsigned parts[3]={0,0,0};
+   unsigned part=0,ms=0;
+   if (dateEnd!=limit) {
+      for (iter=dateEnd+1;iter!=limit;++iter) {
+         char c=*iter;
+         if ((c>='0')&&(c<='9')) {
+            parts[part]=10*parts[part]+(c-'0');
+         } else if ((c==':')&&(part<2)) {
+            ++part;
+         } else if ((c=='.')&&(part==2)) {
+            // Fraction, digits behind milliseconds are dropped
+            unsigned digits=0;
+            for (++iter;iter!=limit;++iter) {
+               c=*iter;
+               if ((c<'0')||(c>'9'))
+                  return "invalid timestamp format";
+               if (digits<3) {
+                  ms=10*ms+(c-'0');
+                  ++digits;
+               }
+            }
+            for (;digits<3;++digits) ms*=10;
+            break;
+         } else {
+            return "invalid timestamp format";
+         }
+      }
+   }
+   // Range check
+   if ((parts[0]>23)||(parts[1]>59)||(parts[2]>59))
+      return "invalid timestamp format";
+   static const uint64_t msPerDay=24*60*60*1000;
+   result.value=static_cast<uint64_t>(date.value)*msPerDay+mergeTime(parts[0],parts[1],parts[2],ms);
+   return nullptr;
+}
+//---------------------------------------------------------------------------
+/// A nullable value, NULL is an empty field in the input
+template <class T> class Nullable
+{
+public:
+   static constexpr TypeTag TAG = T::TAG;
+   using value_t = T;
+   /// The value, unspecified if null
+   T value;
+   /// Is the value NULL?
+   bool null;
+
+   Nullable() : value(), null(true) {}
+   Nullable(const T& value) : value(value), null(false) {}
+
+   /// NULL
+   static Nullable makeNull() { return Nullable(); }
+
+   /// Is NULL?
+   bool isNull() const { return null; }
+   /// Hash
+   inline uint64_t hash() const { return null ? 0 : value.hash(); }
+   /// Comparison, NULL never compares equal
+   bool operator==(const Nullable& n) const { return !null && !n.null && value==n.value; }
+   /// Comparison
+   bool operator==(const T& n) const { return !null && value==n; }
+   /// Cast, returns an error message instead of throwing
+   static const char* tryCastString(const char* str,uint32_t strLen,Nullable& result) {
+      result.null=!strLen;
+      return strLen ? T::tryCastString(str,strLen,result.value) : nullptr;
+   }
+   /// Cast
+   static Nullable castString(const char* str,uint32_t strLen) {
+      if (!strLen) return makeNull();
+      return Nullable(T::castString(str,strLen));
+   }
+   /// Output
+   friend std::ostream& operator<<(std::ostream& out, const Nullable& value) {
+      if (value.null) return out << "NULL";
+      return out << value.value;
+   }
+};
+//---------------------------------------------------------------------------
+template <class T> struct IsNullable { static constexpr bool value = false; };
+template <class T> struct IsNullable<Nullable<T>> { static constexpr bool value = true; };
+//---------------------------------------------------------------------------
+/// A 16 byte string header storing the length, a 4 byte prefix and either
+/// the rest of a short string inline or the offset of a long string in a
+/// separate heap. Most comparisons can be decided on the header alone.
+class InlineString
+{
+public:
+   static constexpr unsigned INLINE_LEN = 12;
+   static constexpr unsigned PREFIX_LEN = 4;
+   /// The length
+   uint32_t len;
+   /// The first characters, zero-padded
+   char prefix[PREFIX_LEN];
+   union {
+      /// Characters behind the prefix if inline, zero-padded
+      char rest[8];
+      /// Offset of the full string in the heap if not inline
+      uint64_t offset;
+   };
 
+   /// The length
+   unsigned length() const { return len; }
+   /// Is the string stored in the header?
+   bool isInline() const { return len<=INLINE_LEN; }
+   /// The first character; prefix and rest are contiguous
+   const char* begin(const char* heap) const { return isInline()?prefix:heap+offset; }
+   /// Behind the last character
+   const char* end(const char* heap) const { return begin(heap)+len; }
+
+   /// Build, str must stay in the heap at offset if it does not fit inline
+   static InlineString build(const char* str,uint32_t strLen,uint64_t offset=0) {
+      InlineString r;
+      memset(&r,0,sizeof(r));
+      r.len=strLen;
+      if (strLen<=INLINE_LEN) {
+         memcpy(r.prefix,str,strLen);
+      } else {
+         memcpy(r.prefix,str,PREFIX_LEN);
+         r.offset=offset;
+      }
+      return r;
+   }
+   /// Length and prefix as one word
+   uint64_t head() const { uint64_t r; memcpy(&r,this,sizeof(r)); return r; }
+   /// Comparison with a header built from a constant; only valid if both are inline
+   bool inlineEqual(const InlineString& other) const { return head()==other.head()&&offset==other.offset; }
+};
+static_assert(sizeof(InlineString)==16);
+//---------------------------------------------------------------------------
+inline bool strEqual(const InlineString& str,const char* heap,const char* str2,unsigned len)
+{
+   if (str.len!=len) return false;
+   if (memcmp(str.prefix,str2,std::min(len,InlineString::PREFIX_LEN))!=0) return false;
+   if (len<=InlineString::PREFIX_LEN) return true;
+   if (str.isInline()) return memcmp(str.rest,str2+InlineString::PREFIX_LEN,len-InlineString::PREFIX_LEN)==0;
+   return memcmp(heap+str.offset+InlineString::PREFIX_LEN,str2+InlineString::PREFIX_LEN,len-InlineString::PREFIX_LEN)==0;
+}
+//---------------------------------------------------------------------------
+inline bool startsWith(const InlineString& str,const char* heap,const char* prefix,unsigned len)
+{
+   if (str.len<len) return false;
+   if (memcmp(str.prefix,prefix,std::min(len,InlineString::PREFIX_LEN))!=0) return false;
+   if (len<=InlineString::PREFIX_LEN) return true;
+   return memcmp(str.begin(heap)+InlineString::PREFIX_LEN,prefix+InlineString::PREFIX_LEN,len-InlineString::PREFIX_LEN)==0;
+}
+//---------------------------------------------------------------------------
+inline bool endsWith(const InlineString& str,const char* heap,const char* suffix,unsigned len)
+{
+   return (str.len>=len)&&(memcmp(str.end(heap)-len,suffix,len)==0);
+}
+//---------------------------------------------------------------------------
+inline bool contains(const InlineString& str,const char* heap,const char* txt,unsigned len)
+{
+   return memmem(str.begin(heap),str.len,txt,len);
+}
 //---------------------------------------------------------------------------
 
 /*
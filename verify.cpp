@@ -0,0 +1,109 @@
+#include "csv-read/csv.hpp"
+#include "common.hpp"
+#include "tpch.hpp"
+#include "verify.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <chrono>
+
+// Verifies converted tables: row counts against the TPC-H cardinalities and
+// one order-independent checksum per column.
+// INPUT: directory containing the per-table column directories (e.g. output/)
+// SF: scale factor to check the row counts against, inferred from orders if unset
+// COMPARE: output of an earlier run, its checksum lines must match
+// Delta segments and deletions from refresh.out are not taken into account.
+
+struct Verification {
+    const RunConfig& cfg;
+    // "<table>.<column>" -> "rows=... nulls=... checksum=..."
+    std::map<std::string, std::string> checksums;
+    std::map<std::string, uint64_t> rows;
+    bool ok = true;
+};
+
+template <typename table>
+void checksum_table(Verification& v, const std::string& name, std::span<const char* const> columns) {
+    auto start = std::chrono::steady_clock::now();
+    typename table::verifier verifier(v.cfg.input + name + "/", v.cfg.threads);
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    for (auto idx = 0u; idx != columns.size(); ++idx) {
+      auto key = name + "." + columns[idx];
+      v.checksums[key] = verifier.columns[idx].to_string();
+      std::cout << key << " " << v.checksums[key] << std::endl;
+    }
+    if (!verifier.aligned()) {
+      std::cout << name << ": columns have different row counts" << std::endl;
+      v.ok = false;
+    }
+    v.rows[name] = verifier.row_count();
+    std::cout << "checksummed " << verifier.row_count() << " rows of " << name << " in " << secs.count() << "s" << std::endl;
+}
+
+void check_counts(Verification& v, double sf) {
+    for (auto& [name, rows] : v.rows) {
+      if (name == "lineitem") {
+        auto plausible = verify::lineitems_plausible(rows, v.rows["orders"]);
+        std::cout << "lineitem: " << rows << " rows, " << (rows / static_cast<double>(v.rows["orders"]))
+                  << " per order " << (plausible ? "ok" : "MISMATCH") << std::endl;
+        v.ok &= plausible;
+        continue;
+      }
+      auto expected = verify::expected_rows(name, sf);
+      std::cout << name << ": " << rows << " rows, expected " << expected << " " << (rows == expected ? "ok" : "MISMATCH") << std::endl;
+      v.ok &= rows == expected;
+    }
+}
+
+void compare_checksums(Verification& v, const char* filename) {
+    std::ifstream in(filename);
+    if (!in) {
+      std::cerr << "could not read " << filename << std::endl;
+      v.ok = false;
+      return;
+    }
+    std::string line;
+    size_t compared = 0;
+    while (std::getline(in, line)) {
+      auto space = line.find(' ');
+      if (space == std::string::npos || line.find(" checksum=") == std::string::npos) {
+        continue;
+      }
+      auto key = line.substr(0, space);
+      auto it = v.checksums.find(key);
+      if (it == v.checksums.end() || it->second != line.substr(space + 1)) {
+        std::cout << key << ": differs from " << filename << " (" << line.substr(space + 1) << ")" << std::endl;
+        v.ok = false;
+      }
+      ++compared;
+    }
+    std::cout << "compared " << compared << " checksums with " << filename << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    auto cfg = read_config();
+    Verification v{cfg};
+    checksum_table<tpch::nation>(v, "nation", tpch::nation_c);
+    checksum_table<tpch::customer>(v, "customer", tpch::customer_c);
+    checksum_table<tpch::lineitem>(v, "lineitem", tpch::lineitem_c);
+    checksum_table<tpch::orders>(v, "orders", tpch::orders_c);
+    checksum_table<tpch::part>(v, "part", tpch::part_c);
+    checksum_table<tpch::partsupp>(v, "partsupp", tpch::partsupp_c);
+    checksum_table<tpch::region>(v, "region", tpch::region_c);
+    checksum_table<tpch::supplier>(v, "supplier", tpch::supplier_c);
+
+    double sf;
+    if (auto scale = getenv("SF")) {
+      sf = atof(scale);
+    } else {
+      sf = verify::infer_scale_factor(v.rows["orders"]);
+      std::cout << "scale factor " << sf << " inferred from orders" << std::endl;
+    }
+    check_counts(v, sf);
+    if (auto compare = getenv("COMPARE")) {
+      compare_checksums(v, compare);
+    }
+    std::cout << (v.ok ? "verification passed" : "verification FAILED") << std::endl;
+    return v.ok ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <optional>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <filesystem>
+#include "types.hpp"
+#include "common.hpp"
+
+/// Verification of converted tables. Row counts are checked against the
+/// TPC-H cardinalities of a scale factor, and every column gets a checksum
+/// that is the wrapping sum of a murmur hash per value. The sum does not
+/// depend on row order, on how the work was split across threads or on the
+/// storage layout (plain, STRINGS=inline or NARROW=1), so checksums can be
+/// compared across runs and machines.
+namespace verify {
+
+    // rows per morsel, equal to the narrow block size so a morsel decodes one block
+    static constexpr size_t MORSEL_ROWS = narrow::BLOCK_ROWS;
+    // summed for NULLs instead of the value hash
+    static constexpr uint64_t NULL_HASH = 0x9e3779b97f4a7c15ull;
+
+    /// TPC-H cardinalities: rows per unit of scale factor, nation and region
+    /// are fixed. lineitem has 1 to 7 items per order, 4 on average, so only
+    /// its ratio to orders is checked, within LINEITEM_TOLERANCE.
+    struct Cardinality {
+        const char* table;
+        double rows;
+        bool scaled;
+    };
+    constexpr Cardinality CARDINALITIES[] = {
+        {"nation", 25, false},      {"region", 5, false},        {"supplier", 10'000, true},
+        {"customer", 150'000, true}, {"part", 200'000, true},     {"partsupp", 800'000, true},
+        {"orders", 1'500'000, true},
+    };
+    static constexpr double LINEITEMS_PER_ORDER = 4.0;
+    static constexpr double LINEITEM_TOLERANCE = 0.01;
+
+    /// Expected rows of a table at scale factor `sf`, 0 if the table has no exact count.
+    inline uint64_t expected_rows(std::string_view table, double sf) {
+        for (auto& entry : CARDINALITIES) {
+            if (table == entry.table) {
+                return entry.scaled ? static_cast<uint64_t>(std::llround(entry.rows * sf)) : entry.rows;
+            }
+        }
+        return 0;
+    }
+
+    /// The scale factor that produces `orders` rows in orders.
+    inline double infer_scale_factor(uint64_t orders) {
+        return orders / CARDINALITIES[6].rows;
+    }
+
+    inline bool lineitems_plausible(uint64_t lineitems, uint64_t orders) {
+        auto expected = orders * LINEITEMS_PER_ORDER;
+        return std::abs(static_cast<double>(lineitems) - expected) <= expected * LINEITEM_TOLERANCE;
+    }
+
+    /// Hashes a string 8 bytes at a time, seeded with its length.
+    inline uint64_t hash_bytes(const char* data, size_t len) {
+        uint64_t h = types::murmurHash64(len);
+        for (; len >= 8; data += 8, len -= 8) {
+            uint64_t word;
+            memcpy(&word, data, 8);
+            h = types::murmurHash64(h ^ word);
+        }
+        if (len) {
+            uint64_t word = 0;
+            memcpy(&word, data, len);
+            h = types::murmurHash64(h ^ word);
+        }
+        return h;
+    }
+
+    /// The hash of a value as it would be printed, independent of its layout.
+    template <typename T>
+    inline uint64_t hash_value(const T& value) {
+        if constexpr (requires { value.len; }) {
+            return hash_bytes(value.value, value.len);
+        } else if constexpr (T::TAG == types::CHAR) {
+            return hash_bytes(&value.value, 1);
+        } else {
+            return types::murmurHash64(static_cast<uint64_t>(value.value));
+        }
+    }
+
+    struct Checksum {
+        uint64_t rows = 0;
+        uint64_t nulls = 0;
+        uint64_t sum = 0;
+
+        inline void add(const Checksum& other) {
+            rows += other.rows;
+            nulls += other.nulls;
+            sum += other.sum;
+        }
+
+        std::string to_string() const {
+            char hex[17];
+            snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(sum));
+            return "rows=" + std::to_string(rows) + " nulls=" + std::to_string(nulls) + " checksum=" + hex;
+        }
+    };
+
+    template <typename T>
+    struct base_type { using type = T; };
+    template <typename T>
+    struct base_type<types::Nullable<T>> { using type = T; };
+
+    /// Checksums the morsels of a column in parallel. hash_morsel(begin, end, emit)
+    /// calls emit(row, hash) for every row of the morsel.
+    template <typename T, typename F>
+    Checksum checksum_rows(const std::string& file, size_t rows, unsigned threads, const F& hash_morsel) {
+        using base_t = typename base_type<T>::type;
+        constexpr bool nullable = !std::is_same_v<T, base_t>;
+        std::optional<ValidityInput<base_t>> validity;
+        if constexpr (nullable) {
+            validity.emplace(file);
+        }
+        auto morsels = (rows + MORSEL_ROWS - 1) / MORSEL_ROWS;
+        std::atomic<size_t> next_morsel = 0;
+        std::mutex result_mutex;
+        Checksum result;
+        run_workers(threads, [&](unsigned) {
+            Checksum local;
+            for (auto morsel = next_morsel++; morsel < morsels; morsel = next_morsel++) {
+                auto begin = morsel * MORSEL_ROWS, end = std::min(rows, begin + MORSEL_ROWS);
+                hash_morsel(begin, end, [&](size_t row, uint64_t hash) {
+                    if (nullable && validity->is_null(row)) {
+                        ++local.nulls;
+                        hash = NULL_HASH;
+                    }
+                    local.sum += hash;
+                });
+                local.rows += end - begin;
+            }
+            std::lock_guard lock(result_mutex);
+            result.add(local);
+        });
+        return result;
+    }
+
+    /// Checksums the column stored in `file` in whichever layout it was written.
+    template <typename T>
+    Checksum checksum_column(const std::string& file, unsigned threads) {
+        using base_t = typename base_type<T>::type;
+        if constexpr (narrow::narrowable<base_t>) {
+            if (std::filesystem::exists(column_sibling(file, "narrow"))) {
+                NarrowColumnInput<base_t> input(file);
+                return checksum_rows<T>(file, input.size(), threads, [&](size_t begin, size_t, const auto& emit) {
+                    std::vector<base_t> values(MORSEL_ROWS);
+                    auto count = input.decode_block(begin / narrow::BLOCK_ROWS, values.data());
+                    for (auto i = 0ul; i != count; ++i) {
+                        emit(begin + i, hash_value(values[i]));
+                    }
+                });
+            }
+        }
+        if constexpr (inline_string_column<base_t>) {
+            if (std::filesystem::exists(column_sibling(file, "inline"))) {
+                InlineStringInput input(file);
+                return checksum_rows<T>(file, input.size(), threads, [&](size_t begin, size_t end, const auto& emit) {
+                    for (auto row = begin; row != end; ++row) {
+                        auto str = input.view(row);
+                        emit(row, hash_bytes(str.data(), str.size()));
+                    }
+                });
+            }
+        }
+        ColumnInput<base_t> input(file.c_str());
+        return checksum_rows<T>(file, input.size(), threads, [&](size_t begin, size_t end, const auto& emit) {
+            for (auto row = begin; row != end; ++row) {
+                emit(row, hash_value(input[row]));
+            }
+        });
+    }
+
+    /// Checksums of all columns of a table.
+    template <typename... Ts>
+    struct TableChecksums {
+        std::array<Checksum, sizeof...(Ts)> columns;
+
+        TableChecksums(const std::string& prefix, unsigned threads)
+          : columns(compute(prefix, threads, std::index_sequence_for<Ts...>{})) {}
+
+        inline uint64_t row_count() const { return columns[0].rows; }
+
+        /// Do all columns have the same number of rows?
+        bool aligned() const {
+            return std::all_of(columns.begin(), columns.end(), [&](const Checksum& c) { return c.rows == row_count(); });
+        }
+
+    private:
+        template <size_t... Is>
+        static std::array<Checksum, sizeof...(Ts)> compute(const std::string& prefix, unsigned threads, std::index_sequence<Is...>) {
+            return {checksum_column<Ts>(column_file<Ts>(prefix, Is), threads)...};
+        }
+    };
+
+} // namespace verify